@@ -0,0 +1,4 @@
+#version 330 core
+// Depth pre-pass: depth is written by fixed function, no color output.
+void main() {
+}
@@ -0,0 +1,26 @@
+#version 330 core
+// Depth pre-pass: position only. gl_Position must be computed exactly like vertex.shader
+// (same expression, both invariant) so the lighting pass can use GL_EQUAL.
+layout (location = 0) in vec3 aPos;   // int16, dequantized like vertex.shader
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 posScale;
+uniform vec3 posOffset;
+
+#ifdef INSTANCED
+layout (location = 5) in mat4 aInstanceModel;
+#endif
+
+invariant gl_Position;
+
+void main() {
+#ifdef INSTANCED
+    mat4 world = aInstanceModel * model;
+#else
+    mat4 world = model;
+#endif
+    vec4 wp = world * vec4(aPos * posScale + posOffset, 1.0);
+    gl_Position = projection * view * wp;
+}
@@ -1,4 +1,13 @@
 #version 330 core
+// Permutation defines are injected after the #version line by ShaderPermutations
+// (src/shader_permutations.h):
+//   NORMAL_MAP        sample the tangent-space normal map
+//   FLIP_Y            invert the green channel (D3D/Unreal normal maps)
+//   CLUSTERED         clustered forward lighting from texture buffers
+//   SHADOWS           cascaded shadow map for the first directional light
+//   INSTANCED         per-instance albedo tint and shininess from vertex.shader
+//   NUM_DIR_LIGHTS, NUM_POINT_LIGHTS, NUM_SPOT_LIGHTS
+//                     forward path: LightBlock is sorted by type, counts are compile-time
 out vec4 FragColor;
 
 in VS_OUT {
@@ -7,8 +16,19 @@ in VS_OUT {
     mat3 TBN;   // world-space
 } fs_in;
 
+#define MAX_LIGHTS 8   // must match MAX_LIGHTS in src/lighting.h
+
+#ifndef NUM_DIR_LIGHTS
+#define NUM_DIR_LIGHTS 0
+#endif
+#ifndef NUM_POINT_LIGHTS
+#define NUM_POINT_LIGHTS 0
+#endif
+#ifndef NUM_SPOT_LIGHTS
+#define NUM_SPOT_LIGHTS 0
+#endif
+
 struct Light {
-    int   type;        // 0=Directional, 1=Point, 2=Spot
     vec3  position;    // for point/spot (world)
     vec3  direction;   // for dir/spot  (world, from light pointing OUT)
     float innerCutoff; // cos(innerAngle)
@@ -18,77 +38,218 @@ struct Light {
     float ambient, diffuse, specular;
 };
 
-uniform int   numLights;
-uniform Light lights[8];
+// std140 mirror of LightGPU (src/lighting.h), filled by LightBuffer once per frame
+struct LightGPU {
+    vec4 positionType;    // xyz = position, w = type
+    vec4 directionInner;  // xyz = direction, w = cos(inner)
+    vec4 colorOuter;      // rgb = color, w = cos(outer)
+    vec4 attenuation;     // x = constant, y = linear, z = quadratic, w = range
+    vec4 intensity;       // x = ambient, y = diffuse, z = specular
+};
+
+Light unpackLight(LightGPU g) {
+    Light L;
+    L.position    = g.positionType.xyz;
+    L.direction   = g.directionInner.xyz;
+    L.innerCutoff = g.directionInner.w;
+    L.outerCutoff = g.colorOuter.w;
+    L.constant    = g.attenuation.x;
+    L.linear      = g.attenuation.y;
+    L.quadratic   = g.attenuation.z;
+    L.color       = g.colorOuter.rgb;
+    L.ambient     = g.intensity.x;
+    L.diffuse     = g.intensity.y;
+    L.specular    = g.intensity.z;
+    return L;
+}
+
+#ifdef CLUSTERED
+// Clustered forward path (see src/light_clusters.h): lights are LightGPU records of
+// 5 texels each, the grid holds (offset, count) per cluster into the index list.
+uniform samplerBuffer  clusterLights;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+uniform ivec3 clusterDims;
+uniform vec2  clusterZParams;   // slice = log(viewDepth) * x + y
+uniform vec2  clusterTileSize;  // pixels per tile
+uniform int   dirLightCount;    // leading entries of clusterIndices
+uniform mat4  view;
+
+LightGPU fetchClusterLight(int i) {
+    LightGPU g;
+    g.positionType   = texelFetch(clusterLights, i * 5 + 0);
+    g.directionInner = texelFetch(clusterLights, i * 5 + 1);
+    g.colorOuter     = texelFetch(clusterLights, i * 5 + 2);
+    g.attenuation    = texelFetch(clusterLights, i * 5 + 3);
+    g.intensity      = texelFetch(clusterLights, i * 5 + 4);
+    return g;
+}
+#else
+layout(std140) uniform LightBlock {
+    ivec4    lightCount;  // x = total, y = directional, z = point, w = spot
+    LightGPU lightData[MAX_LIGHTS];
+};
+#endif
+
+#ifdef SHADOWS
+// Cascaded shadow map (src/shadow_cascades.h); cascade c covers view depth up to shadowSplits[c].
+#define SHADOW_CASCADES 3   // must match ShadowCascades::CASCADES
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 shadowLightSpace[SHADOW_CASCADES];
+uniform vec4 shadowSplits;
+#ifndef CLUSTERED
+uniform mat4 view;
+#endif
+
+// 1 = lit, 0 = fully shadowed; 3x3 PCF on hardware-filtered compares
+float shadowFactor(vec3 N, vec3 Ldir) {
+    float depth = -(view * vec4(fs_in.FragPos, 1.0)).z;
+    int c = 0;
+    while (c < SHADOW_CASCADES && depth > shadowSplits[c]) ++c;
+    if (c == SHADOW_CASCADES) return 1.0;
+
+    // nudge along the normal to fight acne on grazing surfaces
+    vec3 P = fs_in.FragPos + N * 0.02 * (1.0 - max(dot(N, Ldir), 0.0));
+    vec4 ls = shadowLightSpace[c] * vec4(P, 1.0);
+    vec3 uvz = ls.xyz / ls.w * 0.5 + 0.5;
+    if (any(lessThan(uvz, vec3(0.0))) || any(greaterThan(uvz, vec3(1.0)))) return 1.0;
+
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int y = -1; y <= 1; ++y)
+        for (int x = -1; x <= 1; ++x)
+            lit += texture(shadowMap, vec4(uvz.xy + vec2(x, y) * texel, float(c), uvz.z - 0.0005));
+    return lit / 9.0;
+}
+#endif
 
 uniform vec3  viewPos;       // world
 uniform vec3  objectColor;   // albedo
 uniform float shininess;
 
+#ifdef INSTANCED
+flat in vec4 vInstanceMaterial;   // rgb = albedo tint, a = shininess scale
+vec3  materialAlbedo()    { return objectColor * vInstanceMaterial.rgb; }
+float materialShininess() { return shininess * vInstanceMaterial.a; }
+#else
+vec3  materialAlbedo()    { return objectColor; }
+float materialShininess() { return shininess; }
+#endif
+
+#ifdef NORMAL_MAP
 uniform sampler2D normalMap;
-uniform bool  useNormalMap;
-uniform bool  flipNormalY;   // ON if the card is from D3D/Unreal (green is inverted)
 
 vec3 fetchNormalTS(vec2 uv) {
-    vec3 n = texture(normalMap, uv).rgb;
-    // from [0,1] -> [-1,1]
-    n = n * 2.0 - 1.0;
-    if (flipNormalY) n.g = -n.g;
-    return normalize(n);
+    // only XY are stored (BC5 keeps just RG); Z is rebuilt for a unit normal
+    vec2 xy = texture(normalMap, uv).rg * 2.0 - 1.0;
+#ifdef FLIP_Y
+    xy.y = -xy.y;
+#endif
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
 }
+#endif
 
 vec3 getWorldNormal() {
-    if (useNormalMap) {
-        vec3 n_ts = fetchNormalTS(fs_in.TexCoord);
-        return normalize(fs_in.TBN * n_ts); // TS -> world
-    } else {
-        return normalize(fs_in.TBN[2]);     // column N
-    }
+#ifdef NORMAL_MAP
+    vec3 n_ts = fetchNormalTS(fs_in.TexCoord);
+    return normalize(fs_in.TBN * n_ts); // TS -> world
+#else
+    return normalize(fs_in.TBN[2]);     // column N
+#endif
 }
 
-void main() {
-    vec3 N = getWorldNormal();
-    vec3 V = normalize(viewPos - fs_in.FragPos);
+// Phong terms for a light arriving from Ldir (fragment -> light)
+vec3 phong(Light L, vec3 Ldir, vec3 N, vec3 V, float attenuation, float spotMask) {
+    float NdotL = max(dot(N, Ldir), 0.0);
+    vec3  diffuse  = L.diffuse  * NdotL * L.color;
 
-    vec3 total = vec3(0.0);
+    vec3  R = reflect(-Ldir, N);
+    float spec = pow(max(dot(V, R), 0.0), materialShininess());
+    vec3  specular = L.specular * spec * L.color;
+
+    vec3 ambient = L.ambient * L.color;
 
-    for (int i = 0; i < numLights; ++i) {
-        Light L = lights[i];
+    return (ambient + (diffuse + specular) * spotMask) * attenuation;
+}
 
-        vec3 Ldir;        // the direction from the fragment to the source
-        float attenuation = 1.0;
-        float spotMask    = 1.0;
+vec3 shadeDirectional(Light L, vec3 N, vec3 V) {
+    // directional: its direction looks FROM the source, we need to go to the fragment
+    return phong(L, normalize(-L.direction), N, V, 1.0, 1.0);
+}
 
-        if (L.type == 0) {
-            // directional: its direction looks FROM the source, we need to go to the fragment
-            Ldir = normalize(-L.direction);
-        } else {
-            vec3 toL = L.position - fs_in.FragPos;
-            float dist = length(toL);
-            Ldir = toL / max(dist, 1e-6);
+// Directional light that casts the cascaded shadow (the first one in either path)
+vec3 shadeShadowedDirectional(Light L, vec3 N, vec3 V) {
+    vec3 Ldir = normalize(-L.direction);
+#ifdef SHADOWS
+    return phong(L, Ldir, N, V, 1.0, shadowFactor(N, Ldir));
+#else
+    return phong(L, Ldir, N, V, 1.0, 1.0);
+#endif
+}
+
+// Distance attenuation of a point/spot light; also returns the fragment -> light direction
+float pointAttenuation(Light L, out vec3 Ldir) {
+    vec3 toL = L.position - fs_in.FragPos;
+    float dist = length(toL);
+    Ldir = toL / max(dist, 1e-6);
+    return 1.0 / max(L.constant + L.linear * dist + L.quadratic * dist * dist, 1e-6);
+}
 
-            attenuation = 1.0 / max(L.constant + L.linear * dist + L.quadratic * dist * dist, 1e-6);
+vec3 shadePointLight(Light L, vec3 N, vec3 V) {
+    vec3 Ldir;
+    float attenuation = pointAttenuation(L, Ldir);
+    return phong(L, Ldir, N, V, attenuation, 1.0);
+}
 
-            if (L.type == 2) {
-                // the angle between the spotlight axis (looking FROM the source) and the beam TOWARDS the fragment
-                float theta = dot(normalize(-Ldir), normalize(L.direction));
-                float eps = max(L.innerCutoff - L.outerCutoff, 1e-5);
-                spotMask = clamp((theta - L.outerCutoff) / eps, 0.0, 1.0);
-            }
-        }
+vec3 shadeSpotLight(Light L, vec3 N, vec3 V) {
+    vec3 Ldir;
+    float attenuation = pointAttenuation(L, Ldir);
+    // the angle between the spotlight axis (looking FROM the source) and the beam TOWARDS the fragment
+    float theta = dot(normalize(-Ldir), normalize(L.direction));
+    float eps = max(L.innerCutoff - L.outerCutoff, 1e-5);
+    float spotMask = clamp((theta - L.outerCutoff) / eps, 0.0, 1.0);
+    return phong(L, Ldir, N, V, attenuation, spotMask);
+}
 
-        // Phong
-        float NdotL = max(dot(N, Ldir), 0.0);
-        vec3  diffuse  = L.diffuse  * NdotL * L.color;
+// Runtime type dispatch, only needed where light types are mixed (cluster lists)
+vec3 shadeAny(LightGPU g, vec3 N, vec3 V) {
+    int type = int(g.positionType.w);
+    Light L = unpackLight(g);
+    if (type == 0) return shadeDirectional(L, N, V);
+    if (type == 1) return shadePointLight(L, N, V);
+    return shadeSpotLight(L, N, V);
+}
 
-        vec3  R = reflect(-Ldir, N);
-        float spec = pow(max(dot(V, R), 0.0), shininess);
-        vec3  specular = L.specular * spec * L.color;
+void main() {
+    vec3 N = getWorldNormal();
+    vec3 V = normalize(viewPos - fs_in.FragPos);
 
-        vec3 ambient = L.ambient * L.color;
+    vec3 total = vec3(0.0);
 
-        total += (ambient + (diffuse + specular) * spotMask) * attenuation;
+#ifdef CLUSTERED
+    for (int i = 0; i < dirLightCount; ++i) {
+        Light L = unpackLight(fetchClusterLight(int(texelFetch(clusterIndices, i).r)));
+        total += i == 0 ? shadeShadowedDirectional(L, N, V) : shadeDirectional(L, N, V);
     }
 
-    FragColor = vec4(total * objectColor, 1.0);
+    float depth = -(view * vec4(fs_in.FragPos, 1.0)).z;
+    ivec3 c;
+    c.xy = clamp(ivec2(gl_FragCoord.xy / clusterTileSize), ivec2(0), clusterDims.xy - 1);
+    c.z  = clamp(int(log(max(depth, 1e-4)) * clusterZParams.x + clusterZParams.y), 0, clusterDims.z - 1);
+    uvec2 cell = texelFetch(clusterGrid, (c.z * clusterDims.y + c.y) * clusterDims.x + c.x).rg;
+    for (uint k = 0u; k < cell.y; ++k)
+        total += shadeAny(fetchClusterLight(int(texelFetch(clusterIndices, int(cell.x + k)).r)), N, V);
+#else
+#if NUM_DIR_LIGHTS > 0
+    total += shadeShadowedDirectional(unpackLight(lightData[0]), N, V);
+#endif
+    for (int i = 1; i < NUM_DIR_LIGHTS; ++i)
+        total += shadeDirectional(unpackLight(lightData[i]), N, V);
+    for (int i = 0; i < NUM_POINT_LIGHTS; ++i)
+        total += shadePointLight(unpackLight(lightData[NUM_DIR_LIGHTS + i]), N, V);
+    for (int i = 0; i < NUM_SPOT_LIGHTS; ++i)
+        total += shadeSpotLight(unpackLight(lightData[NUM_DIR_LIGHTS + NUM_POINT_LIGHTS + i]), N, V);
+#endif
+
+    FragColor = vec4(total * materialAlbedo(), 1.0);
 }
@@ -0,0 +1,49 @@
+#version 330 core
+// G-buffer pass of the tiled deferred path (src/deferred_renderer.h).
+// Shares vertex.shader with the forward pass; lighting happens in tiled_deferred.compute.shader.
+// Permutation defines: NORMAL_MAP, FLIP_Y, INSTANCED (see fragment.shader).
+layout (location = 0) out vec4 gNormal;   // xyz = world normal, w = shininess
+layout (location = 1) out vec4 gAlbedo;   // rgb = objectColor
+
+in VS_OUT {
+    vec3 FragPos;
+    vec2 TexCoord;
+    mat3 TBN;   // world-space
+} fs_in;
+
+uniform vec3  objectColor;
+uniform float shininess;
+
+#ifdef INSTANCED
+flat in vec4 vInstanceMaterial;   // rgb = albedo tint, a = shininess scale
+#endif
+
+#ifdef NORMAL_MAP
+uniform sampler2D normalMap;
+
+vec3 fetchNormalTS(vec2 uv) {
+    vec2 xy = texture(normalMap, uv).rg * 2.0 - 1.0;   // Z rebuilt, see fragment.shader
+#ifdef FLIP_Y
+    xy.y = -xy.y;
+#endif
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
+#endif
+
+vec3 getWorldNormal() {
+#ifdef NORMAL_MAP
+    return normalize(fs_in.TBN * fetchNormalTS(fs_in.TexCoord));
+#else
+    return normalize(fs_in.TBN[2]);
+#endif
+}
+
+void main() {
+#ifdef INSTANCED
+    gNormal = vec4(getWorldNormal(), shininess * vInstanceMaterial.a);
+    gAlbedo = vec4(objectColor * vInstanceMaterial.rgb, 1.0);
+#else
+    gNormal = vec4(getWorldNormal(), shininess);
+    gAlbedo = vec4(objectColor, 1.0);
+#endif
+}
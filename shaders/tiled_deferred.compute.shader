@@ -0,0 +1,192 @@
+#version 430 core
+// Tiled deferred lighting: one 16x16 work group per screen tile. The group first finds
+// the tile's depth range, culls the light list against the tile frustum into shared
+// memory, then each invocation shades its pixel with only those lights.
+layout (local_size_x = 16, local_size_y = 16) in;
+
+#define MAX_TILE_LIGHTS 512
+
+// std430 mirror of LightGPU (src/lighting.h)
+struct LightGPU {
+    vec4 positionType;    // xyz = position, w = type
+    vec4 directionInner;  // xyz = direction, w = cos(inner)
+    vec4 colorOuter;      // rgb = color, w = cos(outer)
+    vec4 attenuation;     // x = constant, y = linear, z = quadratic, w = range
+    vec4 intensity;       // x = ambient, y = diffuse, z = specular
+};
+
+layout (std430, binding = 1) readonly buffer LightList {
+    ivec4    lightCount;  // x = number of lights
+    LightGPU lights[];
+};
+
+// Tiles that culled more than MAX_TILE_LIGHTS lights, and how many lights they dropped;
+// zeroed before each dispatch and read back a few frames later by DeferredRenderer.
+layout (std430, binding = 2) buffer TileStats {
+    uint overflowTiles;
+    uint droppedLights;
+};
+
+layout (binding = 0) uniform sampler2D gDepth;
+layout (binding = 1) uniform sampler2D gNormal;
+layout (binding = 2) uniform sampler2D gAlbedo;
+layout (rgba8, binding = 0) uniform writeonly image2D outColor;
+
+// Cascaded shadow map of one directional light (src/shadow_cascades.h)
+#define SHADOW_CASCADES 3   // must match ShadowCascades::CASCADES
+layout (binding = 4) uniform sampler2DArrayShadow shadowMap;
+uniform mat4 shadowLightSpace[SHADOW_CASCADES];
+uniform vec4 shadowSplits;
+uniform int  shadowLight;   // index into lights[], -1 = no shadows
+
+uniform mat4  view;
+uniform mat4  invProjection;
+uniform mat4  invView;
+uniform vec3  viewPos;
+uniform vec3  clearColor;
+uniform ivec2 screenSize;
+
+shared uint tileMinDepth;
+shared uint tileMaxDepth;
+shared uint tileLightCount;
+shared uint tileLights[MAX_TILE_LIGHTS];
+
+vec3 unproject(vec2 ndc, float ndcZ) {
+    vec4 v = invProjection * vec4(ndc, ndcZ, 1.0);
+    return v.xyz / v.w;
+}
+
+// Same lookup as shadowFactor() in fragment.shader
+float shadowFactor(vec3 P, vec3 N, vec3 Ldir, float viewDepth) {
+    int c = 0;
+    while (c < SHADOW_CASCADES && viewDepth > shadowSplits[c]) ++c;
+    if (c == SHADOW_CASCADES) return 1.0;
+
+    vec3 Pb = P + N * 0.02 * (1.0 - max(dot(N, Ldir), 0.0));
+    vec4 ls = shadowLightSpace[c] * vec4(Pb, 1.0);
+    vec3 uvz = ls.xyz / ls.w * 0.5 + 0.5;
+    if (any(lessThan(uvz, vec3(0.0))) || any(greaterThan(uvz, vec3(1.0)))) return 1.0;
+
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int y = -1; y <= 1; ++y)
+        for (int x = -1; x <= 1; ++x)
+            lit += texture(shadowMap, vec4(uvz.xy + vec2(x, y) * texel, float(c), uvz.z - 0.0005));
+    return lit / 9.0;
+}
+
+vec3 shadeLight(LightGPU g, vec3 P, vec3 N, vec3 V, float shininess, float shadow) {
+    int   type = int(g.positionType.w);
+    vec3  Ldir;
+    float attenuation = 1.0;
+    float spotMask    = 1.0;
+
+    if (type == 0) {
+        Ldir = normalize(-g.directionInner.xyz);
+    } else {
+        vec3 toL = g.positionType.xyz - P;
+        float dist = length(toL);
+        Ldir = toL / max(dist, 1e-6);
+        attenuation = 1.0 / max(g.attenuation.x + g.attenuation.y * dist + g.attenuation.z * dist * dist, 1e-6);
+        if (type == 2) {
+            float theta = dot(-Ldir, normalize(g.directionInner.xyz));
+            float eps = max(g.directionInner.w - g.colorOuter.w, 1e-5);
+            spotMask = clamp((theta - g.colorOuter.w) / eps, 0.0, 1.0);
+        }
+    }
+
+    vec3  color   = g.colorOuter.rgb;
+    float NdotL   = max(dot(N, Ldir), 0.0);
+    vec3  diffuse = g.intensity.y * NdotL * color;
+    vec3  R       = reflect(-Ldir, N);
+    vec3  specular = g.intensity.z * pow(max(dot(V, R), 0.0), shininess) * color;
+    vec3  ambient = g.intensity.x * color;
+    return (ambient + (diffuse + specular) * spotMask * shadow) * attenuation;
+}
+
+void main() {
+    ivec2 pixel  = ivec2(gl_GlobalInvocationID.xy);
+    bool  inside = all(lessThan(pixel, screenSize));
+    uint  local  = gl_LocalInvocationIndex;
+
+    if (local == 0u) {
+        tileMinDepth = 0x7f7fffffu;  // floatBitsToUint(FLT_MAX)
+        tileMaxDepth = 0u;
+        tileLightCount = 0u;
+    }
+    barrier();
+
+    // 1) tile depth range (positive view depth; float bits order like uints)
+    float depth = inside ? texelFetch(gDepth, pixel, 0).r : 1.0;
+    vec2  ndc   = (vec2(pixel) + 0.5) / vec2(screenSize) * 2.0 - 1.0;
+    vec3  viewP = unproject(ndc, depth * 2.0 - 1.0);
+    bool  geometry = inside && depth < 1.0;
+    if (geometry) {
+        atomicMin(tileMinDepth, floatBitsToUint(-viewP.z));
+        atomicMax(tileMaxDepth, floatBitsToUint(-viewP.z));
+    }
+    barrier();
+
+    // 2) cull lights against the tile frustum: four side planes through the eye + depth range
+    float minZ = uintBitsToFloat(tileMinDepth);
+    float maxZ = uintBitsToFloat(tileMaxDepth);
+    vec2  tileMin = vec2(gl_WorkGroupID.xy * gl_WorkGroupSize.xy) / vec2(screenSize) * 2.0 - 1.0;
+    vec2  tileMax = vec2((gl_WorkGroupID.xy + 1u) * gl_WorkGroupSize.xy) / vec2(screenSize) * 2.0 - 1.0;
+    vec3  c00 = unproject(tileMin, 1.0);
+    vec3  c10 = unproject(vec2(tileMax.x, tileMin.y), 1.0);
+    vec3  c01 = unproject(vec2(tileMin.x, tileMax.y), 1.0);
+    vec3  c11 = unproject(tileMax, 1.0);
+    vec3  center = c00 + c10 + c01 + c11;
+    vec3  planes[4];
+    planes[0] = normalize(cross(c00, c01));  // left
+    planes[1] = normalize(cross(c11, c10));  // right
+    planes[2] = normalize(cross(c10, c00));  // bottom
+    planes[3] = normalize(cross(c01, c11));  // top
+    for (int p = 0; p < 4; ++p)
+        if (dot(planes[p], center) < 0.0) planes[p] = -planes[p];  // make them face inward
+
+    bool tileHasGeometry = minZ <= maxZ;
+    for (uint i = local; tileHasGeometry && i < uint(lightCount.x); i += gl_WorkGroupSize.x * gl_WorkGroupSize.y) {
+        LightGPU g = lights[i];
+        bool visible = true;
+        if (int(g.positionType.w) != 0) {
+            float r = g.attenuation.w;
+            vec3  c = (view * vec4(g.positionType.xyz, 1.0)).xyz;
+            visible = (-c.z + r >= minZ) && (-c.z - r <= maxZ);
+            for (int p = 0; p < 4 && visible; ++p)
+                visible = dot(planes[p], c) > -r;
+        }
+        if (visible) {
+            uint slot = atomicAdd(tileLightCount, 1u);
+            if (slot < MAX_TILE_LIGHTS) tileLights[slot] = i;
+        }
+    }
+    barrier();
+
+    if (local == 0u && tileLightCount > uint(MAX_TILE_LIGHTS)) {
+        atomicAdd(overflowTiles, 1u);
+        atomicAdd(droppedLights, tileLightCount - uint(MAX_TILE_LIGHTS));
+    }
+
+    // 3) shade
+    if (!inside) return;
+    vec3 result = clearColor;
+    if (geometry) {
+        vec4 nS = texelFetch(gNormal, pixel, 0);
+        vec3 albedo = texelFetch(gAlbedo, pixel, 0).rgb;
+        vec3 P = (invView * vec4(viewP, 1.0)).xyz;
+        vec3 N = normalize(nS.xyz);
+        vec3 V = normalize(viewPos - P);
+        vec3 total = vec3(0.0);
+        uint n = min(tileLightCount, uint(MAX_TILE_LIGHTS));
+        for (uint k = 0u; k < n; ++k) {
+            uint  li = tileLights[k];
+            float shadow = 1.0;
+            if (int(li) == shadowLight)
+                shadow = shadowFactor(P, N, normalize(-lights[li].directionInner.xyz), -viewP.z);
+            total += shadeLight(lights[li], P, N, V, nS.w, shadow);
+        }
+        result = total * albedo;
+    }
+    imageStore(outColor, pixel, vec4(result, 1.0));
+}
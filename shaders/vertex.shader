@@ -1,9 +1,9 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
-layout (location = 2) in vec2 aTex;
-layout (location = 3) in vec3 aTangent;
-layout (location = 4) in vec3 aBitangent;
+// Packed vertex (PackedVertex in src/model.h)
+layout (location = 0) in vec3 aPos;      // int16, dequantized with posScale/posOffset
+layout (location = 1) in vec3 aNormal;   // snorm 10:10:10
+layout (location = 2) in vec2 aTex;      // half float
+layout (location = 3) in vec4 aTangent;  // snorm 10:10:10, w = bitangent handedness
 
 out VS_OUT {
     vec3 FragPos;     // world space
@@ -14,6 +14,18 @@ out VS_OUT {
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform vec3 posScale;   // object-space position = aPos * posScale + posOffset
+uniform vec3 posOffset;
+
+#ifdef INSTANCED
+// Per-instance attributes (Model::setInstances); the instance transform is applied after model
+layout (location = 5) in mat4 aInstanceModel;    // locations 5..8
+layout (location = 9) in vec4 aInstanceMaterial; // rgb = albedo tint, a = shininess scale
+flat out vec4 vInstanceMaterial;
+#endif
+
+// must match shaders/depth.vertex.shader bit for bit (depth pre-pass uses GL_EQUAL)
+invariant gl_Position;
 
 // 3x3 normal matrix = inverse(transpose(mat3(model)))
 mat3 computeNormalMatrix(mat4 m) {
@@ -22,21 +34,26 @@ mat3 computeNormalMatrix(mat4 m) {
 }
 
 void main() {
-    mat3 Nmat = computeNormalMatrix(model);
+#ifdef INSTANCED
+    mat4 world = aInstanceModel * model;
+    vInstanceMaterial = aInstanceMaterial;
+#else
+    mat4 world = model;
+#endif
+    mat3 Nmat = computeNormalMatrix(world);
 
     // Adding attributes to the world-space
     vec3 N = normalize(Nmat * aNormal);
-    vec3 T_raw = normalize(Nmat * aTangent);
-    vec3 B_raw = normalize(Nmat * aBitangent);
+    vec3 T_raw = normalize(Nmat * aTangent.xyz);
 
     // Orthogonalization of T to N (GramSchmidt) and reconstruction of B with a sign
     vec3 T = normalize(T_raw - N * dot(N, T_raw));
-    float handedness = (dot(cross(N, T), B_raw) < 0.0) ? -1.0 : 1.0;
+    float handedness = (aTangent.w < 0.0) ? -1.0 : 1.0;
     vec3 B = normalize(cross(N, T)) * handedness;
 
     vs_out.TBN = mat3(T, B, N);
 
-    vec4 wp = model * vec4(aPos, 1.0);
+    vec4 wp = world * vec4(aPos * posScale + posOffset, 1.0);
     vs_out.FragPos = wp.xyz;
     vs_out.TexCoord = aTex;
     gl_Position = projection * view * wp;
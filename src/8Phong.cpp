@@ -1,7 +1,8 @@
 /*
  * Annotated for clarity:
  *  - This project implements Phong shading with optional normal mapping,
- *    supports up to 8 lights (directional/point/spot), and uses ImGui for GUI.
+ *    supports up to 8 lights (directional/point/spot) on the forward path and
+ *    thousands with clustered forward shading, and uses ImGui for GUI.
  */
 
 #ifdef _WIN32
@@ -24,6 +25,10 @@
 #include <string>
 #include <cmath>
 #include <cstring> // strcmp, snprintf
+#include <cfloat>
+#include <chrono>
+#include <map>
+#include <thread>
 
 #ifdef USE_IMGUI
 #include "imgui.h"
@@ -32,28 +37,48 @@
 #define TINYFD_NOLIB
 #include "tinyfiledialogs.h"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
 #include "shader.h"
 #include "model.h"
 #include "camera.h"
 #include "lighting.h"
+#include "light_buffer.h"
+#include "light_clusters.h"
+#include "deferred_renderer.h"
+#include "shadow_cascades.h"
+#include "draw_batcher.h"
+#include "model_loader.h"
+#include "texture_loader.h"
+#include "profiler.h"
+#include "benchmark.h"
+#include "scene_file.h"
+#include "shader_permutations.h"
 #include "gui_panel.h"
 
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
+const glm::vec3 CLEAR_COLOR(0.05f, 0.05f, 0.07f);
 
 Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
 float  deltaTime = 0.0f, lastFrame = 0.0f;
 Model* ourModel = nullptr;
 GLuint normalMapTex = 0;
 bool   useNormalMap = false;
+bool   flipNormalY = false;
 
 glm::vec3 objectColor(0.8f);
 float     shininess = 32.0f;
 
 std::vector<LightCPU> lights;
+std::vector<LightCPU> culledLights; // lights that reach the model this frame
+LightBuffer lightBuffer;
+LightClusters lightClusters;
+DeferredRenderer deferredRenderer;
+ShadowCascades shadowCascades;
+ModelLoader modelLoader;
+TextureLoader textureLoader;
+Profiler profiler;
 
 //  
 static bool  g_RotateEnabled = true;
@@ -62,6 +87,12 @@ static float g_RotateSpeed = 0.6f;
 
 // 
 static bool  g_ShowLightGizmos = true;
+static const size_t MAX_GIZMOS = 64; // only the first lights get gizmos in huge light sets
+
+// Lighting path: forward (UBO, max 8 lights), clustered forward (texture buffers),
+// or tiled deferred (G-buffer + compute culling, needs GL 4.3; falls back to forward)
+enum class RenderPath : int { Forward = 0, Clustered = 1, TiledDeferred = 2 };
+static RenderPath g_RenderPath = RenderPath::Forward;
 
 // Blender-
 static glm::vec3 g_OrbitCenter = glm::vec3(0.0f);
@@ -72,16 +103,146 @@ static float     g_PitchDeg = 0.0f;
 // 
 static bool   g_ShowDiag = true;
 static bool   g_VSync = false;
-static bool   g_Stress = false;
-
-// GPU timer query (ping-pong)
-static bool   g_HasTimerQuery = false;
-static GLuint g_TimerQuery[2] = { 0,0 };
-static int    g_TimerWrite = 0;     //   query  
-static double g_LastGpuMs = 0.0;
+static bool   g_Stress = false;       // draw g_StressInstances instanced copies instead of one model
+static int    g_StressInstances = 1000;
+static int    g_InstancesBuilt = 0;   // count in ourModel's instance buffer (0 = needs rebuild)
+static bool   g_Batched = false;      // frustum-culled draws submitted as one multi-draw (DrawBatcher)
+static bool   g_DepthPrepass = false; // depth-only pass, then lighting with GL_EQUAL
+static bool   g_Shadows = true;       // cascaded shadows from the first directional light
+static bool   g_LightCulling = true;  // per-object light culling against the model's bounding sphere
+static float  g_LightCutoff = LIGHT_CUTOFF;
+static double g_ShadowRendersPerSec = 0.0;
+static bool   g_Lod = true;           // pick a simplified LOD from the projected error
+static float  g_LodPixelError = 1.0f;
+static int    g_FrameLod = 0;         // LOD of the unbatched draws this frame
+static float  g_WeldEpsilon = Model::WELD_EPSILON;  // applied on the next model load
+static std::string g_ModelPath;
+static float  g_FarPlane = FAR_PLANE;  // grows to fit a loaded scene
+
+// Scene file (--scene): its models replace the interactive one, each drawn instanced
+struct SceneObject {
+    SceneModelDesc desc;
+    Model*    model = nullptr;    // null until loaded, or if its load failed
+    int       meshOwner = -1;     // earlier object that loads the same mesh file, -1 = loads its own
+    InstanceSet instances;        // its own, since the model may be shared
+    GLuint    normalMap = 0;      // shared by the objects that name the same file
+    glm::vec3 center{ 0.0f };     // world bounding sphere of all its instances
+    float     radius = 0.0f;
+    float     copyRadius = 0.0f;  // largest single instance
+};
+static std::vector<SceneObject> g_SceneObjects;
+static int    g_SceneLoading = -1;  // object the model loader is working on
+static std::string g_ScenePath;
+static double g_SceneParseMs = 0.0;
+static size_t g_SceneInstances = 0;
+
+// Frame timings come from the profiler (zones below); its flame view is a separate window
+static bool   g_ShowProfiler = false;
+static double g_GpuMsByPrepass[2] = { 0.0, 0.0 };  // last GPU draw time without / with pre-pass
 
-static double g_LastCpuMs = 0.0;
 static double g_LastFps = 0.0;
+static unsigned long long g_NameLookupsLastFrame = 0;
+static unsigned long long g_UniformUploadsLastFrame = 0;
+static unsigned long long g_UniformSkipsLastFrame = 0;
+
+// Current framebuffer size (kept by the resize callback)
+static int g_FbWidth = (int)SCR_WIDTH;
+static int g_FbHeight = (int)SCR_HEIGHT;
+
+// Pre-resolved handles for the per-frame uniforms of one lighting shader variant.
+struct SceneUniforms {
+    Uniform<glm::mat4> projection, view, model;
+    Uniform<glm::vec3> viewPos, objectColor;
+    Uniform<float>     shininess;
+    Uniform<int>       normalMap;
+    Uniform<int>       dirLightCount;
+    Uniform<glm::vec2> clusterZParams, clusterTileSize;
+    Uniform<glm::mat4> shadowLightSpace;
+    Uniform<glm::vec4> shadowSplits;
+    DequantizationUniforms dequant;
+
+    // Called once per variant right after it is linked (ShaderPermutations).
+    void init(Shader& sh) {
+        projection   = sh.uniform<glm::mat4>("projection"_u);
+        view         = sh.uniform<glm::mat4>("view"_u);
+        model        = sh.uniform<glm::mat4>("model"_u);
+        viewPos      = sh.uniform<glm::vec3>("viewPos"_u);
+        objectColor  = sh.uniform<glm::vec3>("objectColor"_u);
+        shininess    = sh.uniform<float>("shininess"_u);
+        normalMap    = sh.uniform<int>("normalMap"_u);
+        dirLightCount   = sh.uniform<int>("dirLightCount"_u);
+        clusterZParams  = sh.uniform<glm::vec2>("clusterZParams"_u);
+        clusterTileSize = sh.uniform<glm::vec2>("clusterTileSize"_u);
+        shadowLightSpace = sh.uniform<glm::mat4>("shadowLightSpace"_u);
+        shadowSplits     = sh.uniform<glm::vec4>("shadowSplits"_u);
+        dequant.posScale  = sh.uniform<glm::vec3>("posScale"_u);
+        dequant.posOffset = sh.uniform<glm::vec3>("posOffset"_u);
+
+        // one-time state: sampler units, cluster grid size, light block binding
+        sh.use();
+        sh.set(normalMap, 0);
+        sh.set(sh.uniform<int>("clusterLights"_u), LightClusters::UNIT_LIGHTS);
+        sh.set(sh.uniform<int>("clusterGrid"_u), LightClusters::UNIT_GRID);
+        sh.set(sh.uniform<int>("clusterIndices"_u), LightClusters::UNIT_INDICES);
+        sh.set(sh.uniform<int>("shadowMap"_u), ShadowCascades::TEXTURE_UNIT);
+        sh.set(sh.uniform<glm::ivec3>("clusterDims"_u),
+            glm::ivec3(LightClusters::DIM_X, LightClusters::DIM_Y, LightClusters::DIM_Z));
+        lightBuffer.attach(sh);
+    }
+};
+
+// Position-only program for the depth pre-pass and the shadow cascades.
+struct DepthUniforms {
+    Uniform<glm::mat4> projection, view, model;
+    DequantizationUniforms dequant;
+
+    void init(Shader& sh) {
+        projection = sh.uniform<glm::mat4>("projection"_u);
+        view       = sh.uniform<glm::mat4>("view"_u);
+        model      = sh.uniform<glm::mat4>("model"_u);
+        dequant.posScale  = sh.uniform<glm::vec3>("posScale"_u);
+        dequant.posOffset = sh.uniform<glm::vec3>("posOffset"_u);
+    }
+};
+
+// Layout of the stress instance grid: count copies filling a side^3 cube, x fastest.
+struct StressGrid {
+    int   side = 1, count = 0;
+    float spacing = 1.0f, half = 0.0f;
+
+    // Radius of the instance centers' spread (for light culling).
+    float spread() const { return half * std::sqrt(3.0f); }
+
+    // Translation of the copy nearest p (relative to the grid center).
+    glm::vec3 nearest(const glm::vec3& p) const {
+        if (count <= 0) return glm::vec3(0.0f);
+        glm::ivec3 c = glm::clamp(glm::ivec3(glm::round((p + glm::vec3(half)) / spacing)), glm::ivec3(0), glm::ivec3(side - 1));
+        // the last layer may be partly filled; step back to a cell that has a copy
+        while (c.x + side * (c.y + side * c.z) >= count) {
+            if (c.z > 0) --c.z; else if (c.y > 0) --c.y; else --c.x;
+        }
+        return glm::vec3(c) * spacing - glm::vec3(half);
+    }
+};
+
+// Stress instances: a cube grid around the origin with varied albedo tint and shininess.
+static StressGrid buildStressInstances(Model& m, int count) {
+    std::vector<InstanceData> inst((size_t)count);
+    int side = (int)std::ceil(std::cbrt((double)count));
+    float spacing = 2.5f * std::max(m.boundsRadius, 1e-3f);
+    float half = 0.5f * (side - 1) * spacing;
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 cell((float)(i % side), (float)((i / side) % side), (float)(i / (side * side)));
+        inst[i].Model = glm::translate(glm::mat4(1.0f), cell * spacing - glm::vec3(half));
+        unsigned h = (unsigned)i * 2654435761u;  // cheap per-instance variation
+        inst[i].Material = glm::vec4(0.6f + 0.4f * ((h >> 8) & 255) / 255.0f, 0.6f + 0.4f * ((h >> 16) & 255) / 255.0f,
+            0.6f + 0.4f * ((h >> 24) & 255) / 255.0f, 0.5f + 1.5f * (h & 255) / 255.0f);
+    }
+    m.instances.set(inst);
+    StressGrid grid;
+    grid.side = side; grid.count = count; grid.spacing = spacing; grid.half = half;
+    return grid;
+}
 
 static inline void updateCameraFromOrbit() {
     float yaw = glm::radians(g_YawDeg);
@@ -99,6 +260,19 @@ static inline void updateCameraFromOrbit() {
 // ---------- callbacks ----------
 static void framebuffer_size_callback(GLFWwindow* /*window*/, int width, int height) {
     glViewport(0, 0, width, height);
+    if (width > 0 && height > 0) { g_FbWidth = width; g_FbHeight = height; }
+}
+
+// Projection is rebuilt only when the zoom, the aspect ratio or the far plane actually changes.
+static const glm::mat4& currentProjection() {
+    static glm::mat4 proj(1.0f);
+    static float lastZoom = -1.0f, lastFar = 0.0f;
+    static int lastW = 0, lastH = 0;
+    if (camera.Zoom != lastZoom || g_FbWidth != lastW || g_FbHeight != lastH || g_FarPlane != lastFar) {
+        proj = glm::perspective(glm::radians(camera.Zoom), (float)g_FbWidth / (float)g_FbHeight, NEAR_PLANE, g_FarPlane);
+        lastZoom = camera.Zoom; lastW = g_FbWidth; lastH = g_FbHeight; lastFar = g_FarPlane;
+    }
+    return proj;
 }
 
 // GLFW mouse callback: orbit/pan/dolly depending on modifiers.
@@ -155,31 +329,138 @@ static void scroll_callback(GLFWwindow* /*window*/, double /*xoffset*/, double y
 }
 
 // ---------- helpers ----------
-static GLuint loadTexture2D(const char* path) {
-    int w, h, n; stbi_uc* data = stbi_load(path, &w, &h, &n, 0);
-    if (!data) { std::cerr << "Texture load failed: " << path << std::endl; return 0; }
-    GLenum format = (n == 1 ? GL_RED : (n == 3 ? GL_RGB : GL_RGBA));
-    GLuint tex; glGenTextures(1, &tex); glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    stbi_image_free(data);
-    return tex;
+// Texture uploads for this frame; drops the normal maps whose files failed to decode.
+static void pollTextures() {
+    textureLoader.poll();
+    if (normalMapTex && textureLoader.failed(normalMapTex)) { normalMapTex = 0; useNormalMap = false; }
+    for (SceneObject& o : g_SceneObjects)
+        if (o.normalMap && textureLoader.failed(o.normalMap)) o.normalMap = 0;
 }
 
 // Open a native dialog to choose an optional normal map.
 static void showNormalMapDialog() {
     const char* patterns[] = { "*.png","*.jpg","*.jpeg","*.tga","*.bmp" };
     const char* fp = tinyfd_openFileDialog("Normal map (optional)", "", 5, patterns, "Images", 0);
-    if (fp) { normalMapTex = loadTexture2D(fp); useNormalMap = (normalMapTex != 0); }
+    if (!fp) return;
+    if (normalMapTex) textureLoader.release(normalMapTex);  // the previous map
+    normalMapTex = textureLoader.load(fp, true);
+    useNormalMap = true;
 }
 
-// Load a 3D model via the Model class (Assimp under the hood).
+// Load a 3D model via the Model class (Assimp under the hood) on the loader's worker thread;
+// the current model keeps drawing until adoptLoadedModel() swaps the new one in.
 static void loadModel(const char* path) {
-    delete ourModel; ourModel = new Model(path);
+    if (modelLoader.start(path, g_WeldEpsilon)) g_ModelPath = path;
+}
+
+// Grows the sphere (center, radius) to enclose the sphere (c, r).
+static void enclose(glm::vec3& center, float& radius, const glm::vec3& c, float r) {
+    float dist = glm::distance(center, c);
+    if (dist + r <= radius) return;
+    if (dist + radius <= r) { center = c; radius = r; return; }
+    float grown = 0.5f * (dist + radius + r);
+    center += (c - center) * ((grown - radius) / dist);
+    radius = grown;
+}
+
+// Starts the next scene object after `g_SceneLoading` that loads its own mesh; -1 when all have
+// been tried.
+static void loadNextSceneObject() {
+    while (++g_SceneLoading < (int)g_SceneObjects.size()) {
+        const SceneObject& o = g_SceneObjects[g_SceneLoading];
+        if (o.meshOwner < 0 && modelLoader.start(o.desc.mesh, g_WeldEpsilon)) return;
+    }
+    g_SceneLoading = -1;
+}
+
+static void adoptSceneObject(SceneObject& o, Model* m) {
+    o.model = m;
+    o.instances.set(o.desc.instances);
+    glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+    for (const InstanceData& inst : o.desc.instances) {
+        glm::vec3 c; float r;
+        m->worldSphere(inst.Model, c, r);
+        lo = glm::min(lo, c - r); hi = glm::max(hi, c + r);
+        o.copyRadius = std::max(o.copyRadius, r);
+    }
+    o.center = 0.5f * (lo + hi);
+    o.radius = 0.5f * glm::length(hi - lo);
+    std::vector<InstanceData>().swap(o.desc.instances);  // the instance set keeps its own copy
+    // keep the object inside the far plane as seen from the starting camera
+    g_FarPlane = std::max(g_FarPlane, glm::distance(camera.Position, o.center) + 2.0f * o.radius);
+}
+
+static void adoptLoadedModel() {
+    Model* loaded = modelLoader.poll();
+    if (g_SceneLoading >= 0) {
+        if (!loaded && modelLoader.busy()) return;
+        if (loaded)  // a failed load stays empty, and so do the objects sharing its mesh
+            for (SceneObject& o : g_SceneObjects)
+                if (&o == &g_SceneObjects[g_SceneLoading] || o.meshOwner == g_SceneLoading) adoptSceneObject(o, loaded);
+        loadNextSceneObject();
+        shadowCascades.invalidate();
+        return;
+    }
+    if (!loaded) return;
+    delete ourModel; ourModel = loaded;
+    shadowCascades.invalidate();
+    g_InstancesBuilt = 0;
+}
+
+// Reads a scene file. Its lights (if any) replace the current ones and its camera becomes the
+// orbit now; the models then load one after another through the model loader and start
+// drawing as each one arrives. The normal maps stream in meanwhile.
+static bool loadScene(const std::string& path) {
+    SceneDesc desc;
+    if (!loadSceneFile(path, desc)) return false;
+    if (desc.models.empty()) { std::cout << "ERROR::SCENE::NO_MODELS: " << path << std::endl; return false; }
+    g_ScenePath = path;
+    g_SceneParseMs = desc.parseMs;
+    g_SceneInstances = desc.instanceCount;
+
+    if (desc.hasLights) lights = std::move(desc.lights);
+    if (desc.camera.set) {
+        glm::vec3 d = desc.camera.target - desc.camera.position;
+        float len = glm::length(d);
+        if (len > 0.0f) {
+            d /= len;
+            g_OrbitCenter = desc.camera.target;
+            g_OrbitDist = glm::clamp(len, 0.2f, 500.0f);
+            g_PitchDeg = glm::clamp(glm::degrees(asinf(glm::clamp(d.y, -1.0f, 1.0f))), -89.5f, 89.5f);
+            g_YawDeg = glm::degrees(atan2f(d.z, d.x));
+        }
+        camera.Zoom = desc.camera.fov;
+        updateCameraFromOrbit();
+    }
+
+    std::map<std::string, GLuint> normalMaps;
+    std::map<std::string, int> meshes;  // first object that names each mesh file
+    g_SceneObjects.clear();
+    g_SceneObjects.reserve(desc.models.size());
+    for (SceneModelDesc& m : desc.models) {
+        g_SceneObjects.emplace_back();
+        SceneObject& o = g_SceneObjects.back();
+        auto mesh = meshes.emplace(m.mesh, (int)g_SceneObjects.size() - 1);
+        if (!mesh.second) o.meshOwner = mesh.first->second;
+        if (!m.normalMap.empty()) {
+            GLuint& tex = normalMaps[m.normalMap];
+            if (!tex) tex = textureLoader.load(m.normalMap, true);
+            o.normalMap = tex;
+        }
+        o.desc = std::move(m);
+    }
+    useNormalMap = true;
+    g_SceneLoading = -1;
+    loadNextSceneObject();
+    return true;
+}
+
+// Any model to draw yet: the interactive one or a loaded scene object.
+static bool haveModels() {
+    if (ourModel) return true;
+    for (const SceneObject& o : g_SceneObjects)
+        if (o.model) return true;
+    return false;
 }
 
 // Open a native dialog to choose a 3D model to load.
@@ -189,27 +470,6 @@ static void showModelDialog() {
     if (fp) { std::cout << "Model: " << fp << std::endl; loadModel(fp); }
 }
 
-// Upload the active light array (max 8) into the shader uniforms.
-static void uploadLights(Shader& sh) {
-    int n = (int)lights.size(); if (n > 8) n = 8;
-    glUniform1i(glGetUniformLocation(sh.ID, "numLights"), n);
-    for (int i = 0; i < n; ++i) {
-        std::string b = "lights[" + std::to_string(i) + "].";
-        sh.setInt(b + "type", (int)lights[i].type); // enum class -> int
-        sh.setVec3(b + "position", lights[i].position);
-        sh.setVec3(b + "direction", glm::normalize(lights[i].direction));
-        sh.setFloat(b + "innerCutoff", lights[i].innerCutoff);
-        sh.setFloat(b + "outerCutoff", lights[i].outerCutoff);
-        sh.setFloat(b + "constant", lights[i].constant);
-        sh.setFloat(b + "linear", lights[i].linear);
-        sh.setFloat(b + "quadratic", lights[i].quadratic);
-        sh.setVec3(b + "color", lights[i].color);
-        sh.setFloat(b + "ambient", lights[i].ambient);
-        sh.setFloat(b + "diffuse", lights[i].diffuse);
-        sh.setFloat(b + "specular", lights[i].specular);
-    }
-}
-
 // ---------- : runtime-  GLAD_GL_*  ----------
 static bool HasExtension(const char* name) {
     if (!name || !glad_glGetStringi) return false;
@@ -223,8 +483,8 @@ static bool HasExtension(const char* name) {
 }
 
 static void InitGpuTimersIfAvailable() {
-    bool has_fn = glad_glBeginQuery &&
-        glad_glEndQuery &&
+    bool has_fn = glad_glQueryCounter &&
+        glad_glGetInteger64v &&
         glad_glGetQueryObjectui64v;
 
     GLint major = 0, minor = 0;
@@ -234,8 +494,7 @@ static void InitGpuTimersIfAvailable() {
 
     bool has_ext = HasExtension("GL_ARB_timer_query") || HasExtension("GL_EXT_timer_query");
 
-    g_HasTimerQuery = has_fn && (ver_ok || has_ext);
-    if (g_HasTimerQuery) glGenQueries(2, g_TimerQuery); // ping-pong
+    profiler.init(has_fn && (ver_ok || has_ext));
 }
 
 // Handle keyboard/mouse input (Blender-like camera: orbit/pan/dolly/zoom).
@@ -275,7 +534,7 @@ static void draw_light_gizmos_2d(const glm::mat4& view, const glm::mat4& proj) {
 
     const glm::vec3 anchor = g_OrbitCenter;
 
-    for (size_t i = 0; i < lights.size(); ++i) {
+    for (size_t i = 0; i < lights.size() && i < MAX_GIZMOS; ++i) {
         const auto& L = lights[i];
         if (!L.drawGizmo) continue;
         glm::vec3 dir = glm::normalize(L.direction);
@@ -315,17 +574,545 @@ static void draw_light_gizmos_2d(const glm::mat4& view, const glm::mat4& proj) {
         }
     }
 }
+
+// Flame view of one profiled frame: CPU zones on top, the GPU time of the GPU zones below,
+// both on the CPU clock from the frame's start. Hover a zone for its duration.
+static void draw_profiler_window() {
+    static bool paused = false;
+    static Profiler::Frame shown;
+    if (!g_ShowProfiler) return;
+    Profiler::Scope zone(profiler, "GUI build");
+    if (ImGui::Begin("Profiler", &g_ShowProfiler)) {
+        bool capture = profiler.enabled();
+        if (ImGui::Checkbox("Capture", &capture)) profiler.setEnabled(capture);
+        ImGui::SameLine(); ImGui::Checkbox("Pause view", &paused);
+        ImGui::SameLine();
+        if (ImGui::Button("Slowest frame")) {
+            const Profiler::Frame* slowest = nullptr;
+            for (const auto& f : profiler.history())
+                if (!slowest || f.cpuMs() > slowest->cpuMs()) slowest = &f;
+            if (slowest) { shown = *slowest; paused = true; }
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Export Chrome trace")) profiler.exportChromeTrace("profile.json");
+        if (!paused) {
+            const Profiler::Frame* f = profiler.latestGpu() ? profiler.latestGpu() : profiler.latest();
+            if (f) shown = *f;
+        }
+        ImGui::Text("Frame %llu: CPU %.2f ms, GPU %.2f ms | %zu frames captured, %zu without GPU times, %zu zones dropped",
+            shown.index, shown.cpuMs(), shown.gpuMs(), profiler.history().size(), profiler.droppedGpuFrames(),
+            profiler.droppedZones());
+
+        const float ROW = 18.0f;
+        int cpuRows = 0, gpuRows = 0;
+        double end = shown.cpuEnd;
+        for (const auto& z : shown.zones) {
+            cpuRows = std::max(cpuRows, z.depth + 1);
+            if (shown.gpuValid && z.gpuDepth >= 0) { gpuRows = std::max(gpuRows, z.gpuDepth + 1); end = std::max(end, z.gpuEnd); }
+        }
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        float width = std::max(ImGui::GetContentRegionAvail().x, 200.0f);
+        ImGui::Dummy(ImVec2(width, ROW * (cpuRows + gpuRows + 1)));
+        ImDrawList* dl = ImGui::GetWindowDrawList();
+        double scale = width / std::max(end - shown.cpuBegin, 1e-3);
+        auto bar = [&](const char* name, double begin, double finish, float y) {
+            ImVec2 a(origin.x + (float)((begin - shown.cpuBegin) * scale), y);
+            ImVec2 b(std::max(origin.x + (float)((finish - shown.cpuBegin) * scale), a.x + 1.0f), y + ROW - 1.0f);
+            unsigned h = 2166136261u;  // same name, same color on both timelines
+            for (const char* c = name; *c; ++c) h = (h ^ (unsigned char)*c) * 16777619u;
+            dl->AddRectFilled(a, b, IM_COL32(110 + (h & 127), 110 + ((h >> 8) & 127), 110 + ((h >> 16) & 127), 255));
+            dl->PushClipRect(a, b, true);
+            dl->AddText(ImVec2(a.x + 2.0f, a.y + 2.0f), IM_COL32(0, 0, 0, 255), name);
+            dl->PopClipRect();
+            if (ImGui::IsMouseHoveringRect(a, b)) ImGui::SetTooltip("%s: %.3f ms", name, finish - begin);
+        };
+        for (const auto& z : shown.zones) bar(z.name, z.cpuBegin, z.cpuEnd, origin.y + ROW * z.depth);
+        float gpuTop = origin.y + ROW * (cpuRows + 1);
+        dl->AddText(ImVec2(origin.x, gpuTop - ROW + 2.0f), IM_COL32(200, 200, 200, 255),
+            shown.gpuValid ? "GPU" : "GPU (no times for this frame)");
+        if (shown.gpuValid)
+            for (const auto& z : shown.zones)
+                if (z.gpuDepth >= 0) bar(z.name, z.gpuBegin, z.gpuEnd, gpuTop + ROW * z.gpuDepth);
+    }
+    ImGui::End();
+}
 #endif
 
+// One model drawn this frame: the interactive model or one object of the scene file.
+struct DrawItem {
+    Model*    model;
+    glm::mat4 transform;   // uniform model matrix; instances apply theirs after it
+    const InstanceSet* instances;  // null = the model matrix alone
+    glm::vec3 center;      // world bounding sphere of everything the item draws
+    float     radius;
+    float     copyRadius;  // one copy of the model (the normal map's UV range)
+    float     lodScale;
+    glm::vec3 lodCenter;   // sphere the unbatched LOD is chosen for
+    float     lodRadius;
+    GLuint    normalMap;   // 0 = vertex normals
+    bool      flipY;
+    glm::vec3 color;
+    float     shininess;
+    int       lod = 0;
+    const DrawBatcher* batch = nullptr;  // this frame's culled draws, when batched
+};
+
+// Everything the frame draws, from LOD selection to deferred shading, shared by the window
+// loop and the headless benchmark. Draws into the framebuffer bound on entry.
+struct SceneRenderer {
+    // Lighting programs are compiled per feature set on first use
+    ShaderPermutations<SceneUniforms> forwardShaders{ "shaders/vertex.shader", "shaders/fragment.shader" };
+    ShaderPermutations<SceneUniforms> gbufferShaders{ "shaders/vertex.shader", "shaders/gbuffer.fragment.shader" };
+    ShaderPermutations<DepthUniforms> depthShaders{ "shaders/depth.vertex.shader", "shaders/depth.fragment.shader" };
+    StressGrid stressGrid;
+    bool  lastStress = g_Stress;
+    std::vector<DrawItem> items;
+    std::vector<DrawBatcher> batchers;       // per item, so each keeps its own build between frames
+    std::vector<int> lastLods;               // per item, to notice shadow casters changing
+    std::vector<LightCPU> itemLights;        // forward lights of one item of several
+
+    // last frame's camera and lights, for the gizmos and Diagnostics
+    glm::mat4 projection{ 1.0f }, view{ 1.0f };
+    const std::vector<LightCPU>* frameLights = &lights;
+
+    void render(float t);
+    void precompile();
+};
+
+void SceneRenderer::render(float t) {
+    glClearColor(CLEAR_COLOR.r, CLEAR_COLOR.g, CLEAR_COLOR.b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    const bool deferred = (g_RenderPath == RenderPath::TiledDeferred && deferredRenderer.ready());
+    const bool clustered = (g_RenderPath == RenderPath::Clustered);
+    const bool scene = !g_SceneObjects.empty();
+    projection = currentProjection();
+    view = camera.GetViewMatrix();
+    glm::mat4 model = glm::mat4(1.0f);
+    if (g_RotateEnabled && !scene) {
+        float a = g_RotateSpeed * t;
+        if (g_RotateX) model = glm::rotate(model, a, glm::vec3(1, 0, 0));
+        if (g_RotateY) model = glm::rotate(model, a * 0.7f, glm::vec3(0, 1, 0));
+        if (g_RotateZ) model = glm::rotate(model, a * 1.3f, glm::vec3(0, 0, 1));
+    }
+
+    for (auto& L : lights) {
+        if (L.type == LightType::Spot && L.followCamera) {
+            L.position = camera.Position;
+            L.direction = glm::normalize(camera.Front);
+        }
+    }
+
+    // Stress mode: every draw below becomes one instanced call over g_StressInstances copies
+    if (g_Stress && ourModel && g_InstancesBuilt != g_StressInstances) {
+        stressGrid = buildStressInstances(*ourModel, g_StressInstances);
+        g_InstancesBuilt = g_StressInstances;
+        shadowCascades.invalidate();
+    }
+    if (g_Stress != lastStress) { shadowCascades.invalidate(); lastStress = g_Stress; }
+
+    // What this frame draws: every loaded object of the scene file, or the interactive model
+    items.clear();
+    if (scene) {
+        for (const SceneObject& o : g_SceneObjects)
+            if (o.model)
+                items.push_back({ o.model, model, &o.instances, o.center, o.radius, o.copyRadius,
+                    o.copyRadius / std::max(o.model->boundsRadius, 1e-6f), o.center, o.radius,
+                    useNormalMap ? o.normalMap : 0, o.desc.flipNormalY, o.desc.color, o.desc.shininess });
+    } else if (ourModel) {
+        glm::vec3 center; float radius;
+        ourModel->worldSphere(model, center, radius);
+        float copyRadius = radius;
+        glm::vec3 lodCenter = center;
+        if (g_Stress) {
+            radius += stressGrid.spread();  // the grid is centered on the origin
+            lodCenter += stressGrid.nearest(camera.Position - center);
+        }
+        items.push_back({ ourModel, model, g_Stress ? &ourModel->instances : nullptr, center, radius, copyRadius,
+            copyRadius / std::max(ourModel->boundsRadius, 1e-6f), lodCenter, copyRadius,
+            useNormalMap ? normalMapTex : 0, flipNormalY, objectColor, shininess });
+    }
+
+    // LOD from the projected simplification error; unbatched draws use one LOD per item, for
+    // its copy nearest the camera (or the nearest point of a scene object's instances)
+    LodView lodView;
+    lodView.viewPos = camera.Position;
+    lodView.pixelsPerUnit = g_FbHeight / (2.0f * tanf(glm::radians(camera.Zoom) * 0.5f));
+    lodView.maxPixelError = g_Lod ? g_LodPixelError : 0.0f;
+    bool lodsChanged = lastLods.size() != items.size();
+    lastLods.resize(items.size());
+    for (size_t i = 0; i < items.size(); ++i) {
+        DrawItem& item = items[i];
+        item.lod = item.model->selectLod(lodView, item.lodCenter, item.lodRadius, item.lodScale);
+        if (item.lod != lastLods[i]) { lodsChanged = true; lastLods[i] = item.lod; }
+        // the normal map's UV range spans one copy of the model, seen at the nearest point
+        if (item.normalMap) {
+            float nearest = std::max(glm::distance(item.center, camera.Position) - item.radius, NEAR_PLANE);
+            textureLoader.request(item.normalMap, 2.0f * item.copyRadius * lodView.pixelsPerUnit / nearest);
+        }
+    }
+    if (lodsChanged) shadowCascades.invalidate();  // casters changed
+    if (!items.empty()) g_FrameLod = items[0].lod;
+
+    // batched: the draws each item's DrawBatcher kept after camera frustum culling (not for shadow
+    // casters), built once here for both the depth pre-pass and the lighting pass
+    const bool batched = g_Batched && !items.empty();
+    if (batched) {
+        Profiler::Scope zone(profiler, "batch build", true);
+        while (batchers.size() < items.size()) { batchers.emplace_back(); batchers.back().init(); }
+        for (size_t i = 0; i < items.size(); ++i) {
+            batchers[i].build(*items[i].model, items[i].instances, items[i].transform, projection * view, lodView);
+            items[i].batch = &batchers[i];
+        }
+    }
+    auto drawItem = [&](Shader& s, const DequantizationUniforms& dq, const DrawItem& item, bool useBatch) {
+        if (useBatch) item.model->DrawBatch(s, dq, *item.batch);
+        else if (item.instances) item.model->DrawInstanced(s, dq, *item.instances, item.lod);
+        else item.model->Draw(s, dq, item.lod);
+    };
+    // position-only draws of every item, for the shadow cascades and the depth pre-pass
+    auto drawDepth = [&](const glm::mat4& proj, const glm::mat4& viewMatrix, bool useBatch) {
+        for (const DrawItem& item : items) {
+            ShaderFeatures depthFeatures;
+            depthFeatures.instanced = item.instances != nullptr;
+            auto& depthVariant = depthShaders.get(depthFeatures);
+            Shader& depthShader = *depthVariant.shader;
+            const DepthUniforms& DU = depthVariant.bindings;
+            depthShader.use();
+            depthShader.set(DU.projection, proj);
+            depthShader.set(DU.view, viewMatrix);
+            depthShader.set(DU.model, item.transform);
+            drawItem(depthShader, DU.dequant, item, useBatch);
+        }
+    };
+
+    // Shadow cascades are refreshed only when the light, the casters or the view slices moved
+    const LightCPU* sun = nullptr;
+    for (const auto& L : lights)
+        if (L.type == LightType::Directional) { sun = &L; break; }
+    const bool shadows = g_Shadows && sun && !items.empty();
+    if (shadows) {
+        Profiler::Scope zone(profiler, "shadows", true);
+        shadowCascades.update(*sun, model, view, glm::radians(camera.Zoom), (float)g_FbWidth / (float)g_FbHeight,
+            NEAR_PLANE, [&](const glm::mat4& lightView, const glm::mat4& lightProj) {
+                drawDepth(lightProj, lightView, false);
+            });
+    }
+
+    // Only lights whose range (and spot cone) reaches the drawn bounding spheres are uploaded
+    frameLights = &lights;
+    {
+        Profiler::Scope zone(profiler, "lights", true);
+        if (g_LightCulling && !items.empty()) {
+            glm::vec3 center = items[0].center;
+            float radius = items[0].radius;
+            for (size_t i = 1; i < items.size(); ++i) enclose(center, radius, items[i].center, items[i].radius);
+            cullLights(lights, center, radius, g_LightCutoff, culledLights);
+            frameLights = &culledLights;
+        }
+        if (deferred) {
+            // lights go to the compute pass after the G-buffer is filled
+        } else if (clustered) {
+            lightClusters.build(*frameLights, view, glm::radians(camera.Zoom),
+                (float)g_FbWidth / (float)g_FbHeight, NEAR_PLANE, g_FarPlane, g_LightCutoff);
+            lightClusters.bind();
+        }
+    }
+
+    // Forward lights (per item when there are several), then the lighting variant and its uniforms
+    using LightingVariant = ShaderPermutations<SceneUniforms>::Variant;
+    auto useLighting = [&](const DrawItem& item) -> LightingVariant& {
+        ShaderFeatures features;
+        features.normalMap = item.normalMap && textureLoader.ready(item.normalMap);  // mips stream in coarse first
+        features.flipY = item.flipY;
+        features.shadows = shadows && !deferred;  // the compute pass applies them itself
+        features.instanced = item.instances != nullptr;
+        features.clustered = clustered && !deferred;
+        if (!deferred && !clustered) {
+            const std::vector<LightCPU>* forwardLights = frameLights;
+            if (g_LightCulling && items.size() > 1) {
+                cullLights(lights, item.center, item.radius, g_LightCutoff, itemLights);
+                forwardLights = &itemLights;
+            }
+            lightBuffer.upload(*forwardLights, g_LightCutoff);
+            glm::ivec3 counts = lightBuffer.typeCounts();
+            features.numDir = counts.x; features.numPoint = counts.y; features.numSpot = counts.z;
+        }
+
+        auto& variant = deferred ? gbufferShaders.get(features) : forwardShaders.get(features);
+        Shader& sh = *variant.shader;
+        const SceneUniforms& SU = variant.bindings;
+        Profiler::Scope zone(profiler, "uniform upload", true);
+        sh.use();
+
+        sh.set(SU.projection, projection);
+        sh.set(SU.view, view);
+        sh.set(SU.model, item.transform);
+        sh.set(SU.viewPos, camera.Position);
+        sh.set(SU.objectColor, item.color);
+        sh.set(SU.shininess, item.shininess);
+
+        if (features.clustered) {
+            sh.set(SU.dirLightCount, lightClusters.directionalCount());
+            sh.set(SU.clusterZParams, lightClusters.zParams());
+            sh.set(SU.clusterTileSize, glm::vec2((float)g_FbWidth / LightClusters::DIM_X,
+                (float)g_FbHeight / LightClusters::DIM_Y));
+        }
+
+        if (features.shadows) {
+            sh.set(SU.shadowLightSpace, shadowCascades.lightSpace(), ShadowCascades::CASCADES);
+            sh.set(SU.shadowSplits, shadowCascades.splits());
+            shadowCascades.bind();
+        }
+
+        if (features.normalMap) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, item.normalMap);
+        }
+        return variant;
+    };
+
+    if (deferred) {
+        deferredRenderer.resize(g_FbWidth, g_FbHeight);
+        deferredRenderer.beginGeometryPass();
+    }
+    // a single item binds before the draw zone, so "draw" stays submission only
+    LightingVariant* single = nullptr;
+    if (items.size() == 1) single = &useLighting(items[0]);
+    auto drawLit = [&]() {
+        for (const DrawItem& item : items) {
+            LightingVariant& v = single ? *single : useLighting(item);
+            drawItem(*v.shader, v.bindings.dequant, item, batched);
+        }
+    };
+
+    {
+        Profiler::Scope zone(profiler, "draw", true);
+        if (g_DepthPrepass) {
+            // depth only: every visible pixel then runs the lighting shader exactly once
+            {
+                Profiler::Scope prepass(profiler, "depth pre-pass", true);
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                drawDepth(projection, view, batched);
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            }
+
+            Profiler::Scope lighting(profiler, "lighting", true);
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+            if (single) single->shader->use();
+            drawLit();
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LESS);
+        } else {
+            drawLit();
+        }
+    }
+
+    if (deferred) {
+        Profiler::Scope zone(profiler, "deferred shade", true);
+        deferredRenderer.endGeometryPass();
+        deferredRenderer.shade(*frameLights, view, projection, camera.Position, CLEAR_COLOR,
+            shadows ? &shadowCascades : nullptr, g_LightCutoff);
+    }
+
+    // GPU times arrive a few frames late; keep the draw time by pre-pass state for comparison
+    if (const Profiler::Frame* f = profiler.latestGpu())
+        g_GpuMsByPrepass[f->has("depth pre-pass") ? 1 : 0] = f->gpuMs("draw");
+}
+
+// Compiles the variants the Diagnostics toggles switch between (render path, shadows, normal
+// map, stress instancing) for the current lights, so the first toggle does not stall a frame.
+// Forward variants for other light counts (culling, GUI edits) still compile on first use.
+void SceneRenderer::precompile() {
+    int counts[3] = { 0, 0, 0 };
+    for (int i = 0; i < std::min((int)lights.size(), MAX_LIGHTS); ++i) ++counts[(int)lights[i].type];
+    for (int bits = 0; bits < 8; ++bits) {
+        ShaderFeatures f;
+        f.normalMap = (bits & 1) != 0;
+        f.flipY = flipNormalY;
+        f.instanced = (bits & 2) != 0;
+        if (deferredRenderer.ready()) gbufferShaders.get(f);  // the compute pass applies the shadows
+
+        f.shadows = (bits & 4) != 0;
+        ShaderFeatures clusteredFeatures = f;
+        clusteredFeatures.clustered = true;
+        forwardShaders.get(clusteredFeatures);
+        f.numDir = counts[0]; f.numPoint = counts[1]; f.numSpot = counts[2];
+        forwardShaders.get(f);
+
+        ShaderFeatures depthFeatures;
+        depthFeatures.instanced = (bits & 2) != 0;
+        depthShaders.get(depthFeatures);
+    }
+}
+
+// GL state and renderer subsystems, once the context is current (window or headless).
+static void initRendering() {
+    glEnable(GL_DEPTH_TEST);
+
+    // GPU timer query (runtime detection)
+    InitGpuTimersIfAvailable();
+
+    lightBuffer.init();
+    lightClusters.init();
+    deferredRenderer.init(g_FbWidth, g_FbHeight);
+    shadowCascades.init();
+}
+
+// initial lights
+static void addStartupLights() {
+    lights.clear();
+    lights.push_back({ LightType::Directional, {0,0,0}, glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f)),
+        0.9f, 0.85f, 1.0f, 0.0f, 0.0f, {1,1,1}, 0.15f, 1.0f, 0.3f, true, false });
+
+    lights.push_back({ LightType::Point, { 2,2,2 }, {0,-1,0},
+        0.9f, 0.85f, 1.0f, 0.09f, 0.032f, {1.0f,0.9f,0.8f}, 0.08f, 0.8f, 0.25f, true, false });
+
+    lights.push_back({ LightType::Point, {-2,2,2 }, {0,-1,0},
+        0.9f, 0.85f, 1.0f, 0.09f, 0.032f, {0.8f,0.9f,1.0f}, 0.06f, 0.7f, 0.20f, true, false });
+
+    lights.push_back({ LightType::Spot, camera.Position, camera.Front,
+        cos(glm::radians(12.5f)), cos(glm::radians(17.5f)),
+        1.0f, 0.09f, 0.032f, {1,1,1}, 0.00f, 1.0f, 0.3f, true, false });
+}
+
+// Headless benchmark: loads the model and normal map (or the scene) without dialogs, renders a warm-up and
+// then options.frames frames of an orbit at a fixed 60 Hz script time into an offscreen
+// framebuffer, and reports frame, CPU and GPU times from the profiler.
+static int runBenchmark(const BenchmarkOptions& options) {
+    const int MAX_LOAD_FRAMES = 100000;  // stop waiting for streaming after this many warm-up frames
+
+    HeadlessContext context;
+    if (!context.create(options.width, options.height)) return 1;
+    g_FbWidth = options.width; g_FbHeight = options.height;
+    g_RenderPath = options.path == "clustered" ? RenderPath::Clustered
+        : options.path == "deferred" ? RenderPath::TiledDeferred : RenderPath::Forward;
+    g_Stress = options.instances > 0;
+    g_StressInstances = std::max(options.instances, 1);
+    initRendering();
+    if (g_RenderPath == RenderPath::TiledDeferred && !deferredRenderer.ready())
+        std::cout << "WARNING::BENCHMARK: tiled deferred needs GL 4.3 compute; using forward" << std::endl;
+
+    SceneRenderer scene;
+    addStartupLights();
+    if (!options.scene.empty()) {
+        if (!loadScene(options.scene)) return 1;
+    } else {
+        if (!modelLoader.start(options.model, g_WeldEpsilon)) return 1;
+        if (!options.normalMap.empty()) { normalMapTex = textureLoader.load(options.normalMap, true); useNormalMap = true; }
+    }
+    scatterPointLights(lights, options.lights, g_OrbitCenter);
+    const bool forward = g_RenderPath == RenderPath::Forward || (g_RenderPath == RenderPath::TiledDeferred && !deferredRenderer.ready());
+    if (forward && (int)lights.size() > MAX_LIGHTS) {
+        std::cout << "ERROR::BENCHMARK::TOO_MANY_LIGHTS: the forward path shades at most " << MAX_LIGHTS << " lights, got "
+                  << lights.size() << "; use --path clustered or deferred" << std::endl;
+        return 2;
+    }
+
+    auto frame = [&](int index, float turn) {
+        profiler.beginFrame();
+        float t = index / 60.0f;
+        if (haveModels()) {
+            glm::vec3 center(0.0f); float radius = 0.0f;
+            if (ourModel) {
+                ourModel->worldSphere(glm::mat4(1.0f), center, radius);
+                if (g_Stress) radius += scene.stressGrid.spread();
+            } else {
+                bool first = true;
+                for (const SceneObject& o : g_SceneObjects) {
+                    if (!o.model) continue;
+                    if (first) { center = o.center; radius = o.radius; first = false; }
+                    else enclose(center, radius, o.center, o.radius);
+                }
+            }
+            g_OrbitCenter = center;
+            g_OrbitDist = options.orbitDistance > 0.0f ? options.orbitDistance : 3.0f * radius;
+            g_FarPlane = std::max(g_FarPlane, g_OrbitDist + 2.0f * radius);
+        }
+        g_YawDeg = -90.0f + 360.0f * turn;
+        g_PitchDeg = -options.orbitPitch;  // looking down at the center
+        updateCameraFromOrbit();
+        {
+            Profiler::Scope zone(profiler, "streaming", true);
+            adoptLoadedModel();
+            pollTextures();
+        }
+        context.bind();
+        scene.render(t);
+        {
+            Profiler::Scope zone(profiler, "swap");
+            context.present();
+        }
+        profiler.endFrame();
+    };
+
+    // warm-up: until the model is in, the normal map has streamed what it needs (or all the
+    // texture budget allows), and options.warmup more frames (shader variants, shadow cascades, caches)
+    int index = 0, settled = 0;
+    for (; settled < options.warmup && index < MAX_LOAD_FRAMES; ++index) {
+        frame(index, 0.0f);
+        if (!modelLoader.busy() && !haveModels()) {
+            std::cout << "ERROR::BENCHMARK::MODEL_LOAD_FAILED: " << (options.scene.empty() ? options.model : options.scene) << std::endl;
+            return 1;
+        }
+        if (haveModels() && !modelLoader.busy() && textureLoader.pending() <= textureLoader.blocked()) settled++;
+        else std::this_thread::sleep_for(std::chrono::milliseconds(1));  // leave the loader threads a core
+    }
+    if (settled < options.warmup)
+        std::cout << "WARNING::BENCHMARK: still streaming after " << MAX_LOAD_FRAMES << " warm-up frames; measuring anyway" << std::endl;
+    else if (textureLoader.blocked())
+        std::cout << "WARNING::BENCHMARK: " << textureLoader.blocked() << " texture(s) held below their wanted level by the texture budget" << std::endl;
+
+    const unsigned long long first = profiler.frameIndex();
+    const unsigned long long last = first + options.frames;
+    std::vector<BenchmarkSample> samples;
+    samples.reserve(options.frames);
+    unsigned long long next = first;
+    auto collect = [&]() {
+        for (const auto& f : profiler.history())
+            if (f.index >= next && f.index < last) {
+                samples.push_back({ f.cpuMs(), f.cpuMs() - f.cpuMs("swap"), f.gpuValid ? f.gpuMs() : -1.0 });
+                next = f.index + 1;
+            }
+    };
+    for (int i = 0; i < options.frames; ++i, ++index) {
+        frame(index, options.orbitTurns * i / options.frames);
+        collect();
+    }
+    glFinish();
+    profiler.beginFrame(); profiler.endFrame();  // reads back the last queries
+    collect();
+
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    bool written = writeBenchmarkReport(options, renderer ? renderer : "(null)", samples);
+    profiler.shutdown();
+    g_SceneObjects.clear();  // their instance buffers, while the context is still current
+    return written ? 0 : 1;
+}
+
 // Entry point: initialize window/GL, set callbacks, run the render loop.
-int main() {
+// With --benchmark, runs the headless benchmark instead (see benchmark.h); with --scene, opens
+// that scene file instead of asking for a model.
+int main(int argc, char** argv) {
     setlocale(LC_ALL, "ru");
 
+    BenchmarkOptions options;
+    bool argsValid = true;
+    if (parseBenchmarkArgs(argc, argv, options, argsValid)) return argsValid ? runBenchmark(options) : 2;
+    if (!argsValid) return 2;
+
     if (!glfwInit()) return -1;
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    // Prefer 4.3 (compute for the tiled deferred path), fall back to 3.3
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Phong + NormalMap + Lights + GUI", nullptr, nullptr);
+    if (!window) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Phong + NormalMap + Lights + GUI", nullptr, nullptr);
+    }
     if (!window) return -1;
 
     glfwMakeContextCurrent(window);
@@ -334,18 +1121,15 @@ int main() {
     glfwSetScrollCallback(window, scroll_callback);
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) return -1;
-    glEnable(GL_DEPTH_TEST);
 
     // VSync
     glfwSwapInterval(g_VSync ? 1 : 0);
 
-    // GPU timer query (runtime detection)
-    InitGpuTimersIfAvailable();
-
-    Shader shader("shaders/vertex.shader", "shaders/fragment.shader");
+    initRendering();
+    SceneRenderer scene;
 
 #ifdef USE_IMGUI
-    GuiPanel gui(window, objectColor, shininess, useNormalMap, lights,
+    GuiPanel gui(window, objectColor, shininess, useNormalMap, flipNormalY, lights,
         (glm::vec3&)camera.Position, (glm::vec3&)camera.Front,
         g_ShowLightGizmos, g_RotateEnabled, g_RotateX, g_RotateY, g_RotateZ, g_RotateSpeed,
         g_OrbitCenter);
@@ -363,120 +1147,65 @@ int main() {
         updateCameraFromOrbit();
     }
 
-    showModelDialog();
-    if (!ourModel) { return 0; }
-    showNormalMapDialog();
-
-    // initial lights
-    lights.clear();
-    lights.push_back({ LightType::Directional, {0,0,0}, glm::normalize(glm::vec3(-0.4f, -1.0f, -0.3f)),
-        0.9f, 0.85f, 1.0f, 0.0f, 0.0f, {1,1,1}, 0.15f, 1.0f, 0.3f, true, false });
-
-    lights.push_back({ LightType::Point, { 2,2,2 }, {0,-1,0},
-        0.9f, 0.85f, 1.0f, 0.09f, 0.032f, {1.0f,0.9f,0.8f}, 0.08f, 0.8f, 0.25f, true, false });
-
-    lights.push_back({ LightType::Point, {-2,2,2 }, {0,-1,0},
-        0.9f, 0.85f, 1.0f, 0.09f, 0.032f, {0.8f,0.9f,1.0f}, 0.06f, 0.7f, 0.20f, true, false });
-
-    lights.push_back({ LightType::Spot, camera.Position, camera.Front,
-        cos(glm::radians(12.5f)), cos(glm::radians(17.5f)),
-        1.0f, 0.09f, 0.032f, {1,1,1}, 0.00f, 1.0f, 0.3f, true, false });
+    addStartupLights();
+    if (!options.scene.empty()) {
+        if (!loadScene(options.scene)) return -1;
+    } else {
+        showModelDialog();
+        if (!modelLoader.busy()) { return 0; }
+        showNormalMapDialog();
+    }
+    scene.precompile();  // while the model loads on its worker
 
+    unsigned long long nameLookupsMark = Shader::nameLookups();
+    unsigned long long uploadsMark = Shader::uniformUploads(), skipsMark = Shader::uniformSkips();
+    unsigned long long shadowRendersMark = 0;
+    double shadowRateStart = glfwGetTime();
     while (!glfwWindowShouldClose(window)) {
+        profiler.beginFrame();
         float t = (float)glfwGetTime(); deltaTime = t - lastFrame; lastFrame = t;
 
-        processInput(window);
-        updateCameraFromOrbit();
-
-        glClearColor(0.05f, 0.05f, 0.07f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        {
+            Profiler::Scope zone(profiler, "input");
+            processInput(window);
+            updateCameraFromOrbit();
+        }
+        {
+            Profiler::Scope zone(profiler, "streaming", true);
+            adoptLoadedModel();
+            pollTextures();
+        }
 
 #ifdef USE_IMGUI
-        if (g_ShowDiag) ImGui::SetNextWindowBgAlpha(0.9f);
+        {
+            Profiler::Scope zone(profiler, "GUI build");
+            if (g_ShowDiag) ImGui::SetNextWindowBgAlpha(0.9f);
 // ImGui: start a new UI frame.
-        gui.beginFrame();
+            gui.beginFrame();
 // ImGui: build the Lighting & Material panel and controls.
-        gui.draw();
-#endif
-
-        // ---- CPU timer start
-        double cpuStart = glfwGetTime();
-
-        shader.use();
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom),
-            (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 model = glm::mat4(1.0f);
-        if (g_RotateEnabled) {
-            float a = g_RotateSpeed * t;
-            if (g_RotateX) model = glm::rotate(model, a, glm::vec3(1, 0, 0));
-            if (g_RotateY) model = glm::rotate(model, a * 0.7f, glm::vec3(0, 1, 0));
-            if (g_RotateZ) model = glm::rotate(model, a * 1.3f, glm::vec3(0, 0, 1));
-        }
-        shader.setMat4("projection", projection);
-        shader.setMat4("view", view);
-        shader.setMat4("model", model);
-
-        for (auto& L : lights) {
-            if (L.type == LightType::Spot && L.followCamera) {
-                L.position = camera.Position;
-                L.direction = glm::normalize(camera.Front);
-            }
-        }
-
-        shader.setVec3("viewPos", camera.Position);
-        shader.setVec3("objectColor", objectColor);
-        shader.setFloat("shininess", shininess);
-
-        uploadLights(shader);
-
-        shader.setBool("useNormalMap", useNormalMap);
-        if (useNormalMap && normalMapTex) {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, normalMapTex);
-            shader.setInt("normalMap", 0);
-        }
-
-        // --- GPU timer start (  query)
-        if (g_HasTimerQuery) glBeginQuery(GL_TIME_ELAPSED, g_TimerQuery[g_TimerWrite]);
-
-        if (ourModel) ourModel->Draw(shader);
-
-        // - (x10)
-        if (g_Stress) {
-            for (int i = 0; i < 10; ++i) {
-                shader.setFloat("shininess", shininess + i * 0.01f);
-                if (ourModel) ourModel->Draw(shader);
-            }
-        }
-
-        // --- GPU timer end
-        if (g_HasTimerQuery) glEndQuery(GL_TIME_ELAPSED);
-
-        // --- GPU timer read (  query,  )
-        if (g_HasTimerQuery) {
-            int readIdx = 1 - g_TimerWrite;
-            if (g_TimerQuery[readIdx]) {
-                GLuint available = 0;
-                glGetQueryObjectuiv(g_TimerQuery[readIdx], GL_QUERY_RESULT_AVAILABLE, &available);
-                if (available) {
-                    GLuint64 ns = 0;
-                    glGetQueryObjectui64v(g_TimerQuery[readIdx], GL_QUERY_RESULT, &ns);
-                    g_LastGpuMs = ns / 1e6;
-                }
-            }
-            g_TimerWrite = 1 - g_TimerWrite; // 
+            gui.draw();
         }
+#endif
 
-        // ---- CPU timer end
-        g_LastCpuMs = (glfwGetTime() - cpuStart) * 1000.0;
+        scene.render(t);
         g_LastFps = (deltaTime > 0.0 ? 1.0 / deltaTime : 0.0);
+        g_NameLookupsLastFrame = Shader::nameLookups() - nameLookupsMark;
+        nameLookupsMark = Shader::nameLookups();
+        g_UniformUploadsLastFrame = Shader::uniformUploads() - uploadsMark;
+        g_UniformSkipsLastFrame = Shader::uniformSkips() - skipsMark;
+        uploadsMark = Shader::uniformUploads(); skipsMark = Shader::uniformSkips();
+        if (t - shadowRateStart >= 1.0) {
+            g_ShadowRendersPerSec = (shadowCascades.totalRenders() - shadowRendersMark) / (t - shadowRateStart);
+            shadowRendersMark = shadowCascades.totalRenders();
+            shadowRateStart = t;
+        }
 
 #ifdef USE_IMGUI
-        draw_light_gizmos_2d(view, projection);
+        draw_light_gizmos_2d(scene.view, scene.projection);
 
         // Diagnostics
         if (g_ShowDiag) {
+            Profiler::Scope zone(profiler, "GUI build");
             if (ImGui::Begin("Diagnostics", &g_ShowDiag, ImGuiWindowFlags_AlwaysAutoResize)) {
                 const char* vendor = (const char*)glGetString(GL_VENDOR);
                 const char* renderer = (const char*)glGetString(GL_RENDERER);
@@ -496,12 +1225,189 @@ int main() {
                 ImGui::Separator();
                 ImGui::Checkbox("VSync", &g_VSync); ImGui::SameLine();
                 if (ImGui::Button("Apply")) glfwSwapInterval(g_VSync ? 1 : 0);
-                ImGui::Checkbox("Stress scene (x10 draws)", &g_Stress);
+                if (g_SceneObjects.empty()) ImGui::Checkbox("Instanced stress", &g_Stress);
+                if (g_Stress && g_SceneObjects.empty()) {
+                    ImGui::SliderInt("Instances", &g_StressInstances, 1, 1000000, "%d",
+                        ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+                    if (ourModel)
+                        ImGui::Text("%d instances, %.1f M triangles / draw", ourModel->instances.count(),
+                            ourModel->instances.count() * ourModel->triangleCount() / 1e6);
+                }
+                ImGui::Checkbox("Depth pre-pass", &g_DepthPrepass);
+                ImGui::Checkbox("Batched submission (culled, multi-draw)", &g_Batched);
+                ImGui::Checkbox("Directional shadows", &g_Shadows);
+                ImGui::Checkbox("Per-object light culling", &g_LightCulling);
+                ImGui::Checkbox("LOD", &g_Lod);
+                if (g_Lod) {
+                    ImGui::SameLine();
+                    ImGui::SliderFloat("Max pixel error", &g_LodPixelError, 0.25f, 16.0f, "%.2f px", ImGuiSliderFlags_Logarithmic);
+                }
+                ImGui::SliderFloat("Light cutoff", &g_LightCutoff, 1.0f / 4096.0f, 1.0f / 16.0f, "%.5f",
+                    ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+                const char* paths[] = { "Forward", "Clustered forward", "Tiled deferred" };
+                int path = (int)g_RenderPath;
+                if (ImGui::Combo("Render path", &path, paths, IM_ARRAYSIZE(paths))) g_RenderPath = (RenderPath)path;
+                if (g_RenderPath == RenderPath::TiledDeferred && !deferredRenderer.ready())
+                    ImGui::TextColored(ImVec4(1, 0.7f, 0, 1), "Tiled deferred needs GL 4.3 compute; using forward");
 
                 ImGui::Separator();
-                ImGui::Text("CPU frame: %.2f ms (%.0f FPS)", g_LastCpuMs, g_LastFps);
-                if (g_HasTimerQuery) ImGui::Text("GPU time:  %.2f ms", g_LastGpuMs);
+                const Profiler::Frame* cpuFrame = profiler.latest();
+                const Profiler::Frame* gpuFrame = profiler.latestGpu();
+                ImGui::Text("CPU frame: %.2f ms (%.0f FPS)", cpuFrame ? cpuFrame->cpuMs() : 0.0, g_LastFps);
+                if (profiler.gpuTimers()) {
+                    ImGui::Text("GPU time:  %.2f ms in timed zones, draw %.2f ms", gpuFrame ? gpuFrame->gpuMs() : 0.0,
+                        gpuFrame ? gpuFrame->gpuMs("draw") : 0.0);
+                    ImGui::Text("  draw without pre-pass: %.2f ms | with pre-pass: %.2f ms",
+                        g_GpuMsByPrepass[0], g_GpuMsByPrepass[1]);
+                }
                 else ImGui::TextColored(ImVec4(1, 0.7f, 0, 1), "GPU timer not supported");
+                ImGui::Checkbox("Profiler (flame view, trace export)", &g_ShowProfiler);
+                ImGui::Text("By-name uniform lookups: %llu / frame", g_NameLookupsLastFrame);
+                ImGui::Text("Uniform uploads: %llu sent, %llu skipped / frame",
+                    g_UniformUploadsLastFrame, g_UniformSkipsLastFrame);
+                if (ourModel) {
+                    ImGui::Text("Mesh: %zu vertices, %zu triangles, %zu submeshes", ourModel->vertexCount(),
+                        ourModel->triangleCount(), ourModel->submeshes.size());
+                    ImGui::Text("Mesh cache: %s, loaded in %.1f ms", ourModel->cacheHit ? "hit" : "miss (imported and cooked)",
+                        ourModel->loadMs);
+                    std::string chain;
+                    for (int l = 0; l < ourModel->lodCount; ++l)
+                        chain += (l ? " / " : "") + std::to_string(ourModel->triangleCount(l));
+                    ImGui::Text("LOD chain: %s triangles", chain.c_str());
+                    // triangles drawn this frame against LOD 0 for the same draws
+                    size_t copies = g_Stress ? (size_t)ourModel->instances.count() : 1;
+                    size_t full = 0, drawn = 0;
+                    const DrawBatcher* batch = scene.items.empty() ? nullptr : scene.items[0].batch;
+                    if (g_Batched && batch) {
+                        drawn = batch->triangles();
+                        full = batch->lod0Triangles();
+                        ImGui::Text("LOD objects: %zu / %zu / %zu / %zu", batch->lodObjects(0), batch->lodObjects(1),
+                            batch->lodObjects(2), batch->lodObjects(3));
+                    } else {
+                        drawn = copies * ourModel->triangleCount(g_FrameLod);
+                        full = copies * ourModel->triangleCount();
+                        ImGui::Text("Selected LOD: %d (error %.4g)", g_FrameLod, ourModel->lodErrors[g_FrameLod]);
+                    }
+                    if (full)
+                        ImGui::Text("Triangles drawn: %.2f M of %.2f M at LOD 0 (-%.0f%%)", drawn / 1e6, full / 1e6,
+                            100.0 * (1.0 - (double)drawn / full));
+                    size_t packedBytes = ourModel->vertexBytes() + ourModel->indexBytes();
+                    ImGui::Text("GPU mesh: %.1f KB (%zu B/vertex, %d-bit indices) vs %.1f KB float layout, %.2fx smaller",
+                        packedBytes / 1024.0, sizeof(PackedVertex), ourModel->indexType() == GL_UNSIGNED_SHORT ? 16 : 32,
+                        ourModel->floatLayoutBytes() / 1024.0, (double)ourModel->floatLayoutBytes() / std::max<size_t>(packedBytes, 1));
+                    const MeshStats& in = ourModel->importStats;
+                    const MeshStats& opt = ourModel->optimizedStats;
+                    ImGui::Text("Vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overdraw %.3f -> %.3f (%.0f ms)",
+                        in.acmr(), opt.acmr(), in.atvr(), opt.atvr(), in.overdraw(), opt.overdraw(), ourModel->optimizeMs);
+                    ImGui::Text("Weld: %zu -> %zu vertices (-%.1f%%), %.1f ms", ourModel->importedVertices, ourModel->vertexCount(),
+                        100.0 * (1.0 - (double)ourModel->vertexCount() / std::max<size_t>(ourModel->importedVertices, 1)), ourModel->weldMs);
+                    ImGui::SetNextItemWidth(120);
+                    if (ImGui::InputFloat("Weld epsilon", &g_WeldEpsilon, 0.0f, 0.0f, "%.1e"))
+                        g_WeldEpsilon = std::max(g_WeldEpsilon, 0.0f);
+                    ImGui::SameLine();
+                    if (ImGui::Button("Reload model") && !modelLoader.busy()) { std::string p = g_ModelPath; loadModel(p.c_str()); }
+                }
+                if (!g_SceneObjects.empty()) {
+                    size_t loaded = 0, triangles = 0, drawn = 0;
+                    for (const SceneObject& o : g_SceneObjects)
+                        if (o.model) { loaded++; triangles += (size_t)o.instances.count() * o.model->triangleCount(); }
+                    for (const DrawItem& item : scene.items)  // unbatched draws, at the LOD selected this frame
+                        drawn += (size_t)item.instances->count() * item.model->triangleCount(item.lod);
+                    ImGui::Text("Scene %s: %zu of %zu models loaded, %zu instances, parsed in %.1f ms", g_ScenePath.c_str(),
+                        loaded, g_SceneObjects.size(), g_SceneInstances, g_SceneParseMs);
+                    ImGui::Text("Scene triangles: %.2f M at LOD 0, %.2f M at the selected LODs", triangles / 1e6, drawn / 1e6);
+                    if (!g_Batched)
+                        ImGui::Text("Unbatched: one LOD per model, for the nearest point of the sphere around its instances");
+                }
+                if (modelLoader.busy())
+                    ImGui::Text("Loading %s: %s %.0f%%", modelLoader.path().c_str(),
+                        modelLoader.uploading() ? "uploading" : "importing", modelLoader.progress() * 100.0f);
+                ImGui::Text("Model upload stall: %.2f ms last load, %.2f ms longest", modelLoader.lastStallMs(),
+                    modelLoader.longestStallMs());
+                if (normalMapTex && textureLoader.decoding(normalMapTex))
+                    ImGui::Text("Normal map: decoding");
+                else if (normalMapTex)
+                    ImGui::Text("Normal map: %s %.1f MB (%.1f MB uncompressed), mip %d resident, mip %d wanted",
+                        textureLoader.compressed(normalMapTex) ? "BC5" : "raw", textureLoader.gpuBytes(normalMapTex) / (1024.0 * 1024.0),
+                        textureLoader.rawBytes(normalMapTex) / (1024.0 * 1024.0), textureLoader.baseLevel(normalMapTex),
+                        textureLoader.wantedLevel(normalMapTex));
+                if (normalMapTex && !textureLoader.decoding(normalMapTex))
+                    ImGui::Text("Texture cache: %s, loaded in %.1f ms", textureLoader.cacheHit(normalMapTex) ? "hit" : "miss (decoded and cooked)",
+                        textureLoader.loadMs(normalMapTex));
+                ImGui::Text("Textures: %zu streaming, %.1f MB uploaded, upload stall %.2f ms last, %.2f ms longest",
+                    textureLoader.pending(), textureLoader.uploadedBytes() / (1024.0 * 1024.0), textureLoader.lastStallMs(),
+                    textureLoader.longestStallMs());
+                ImGui::Text("Texture residency: %.1f MB resident / %.1f MB requested, %zu levels evicted",
+                    textureLoader.residentBytes() / (1024.0 * 1024.0), textureLoader.requestedBytes() / (1024.0 * 1024.0),
+                    textureLoader.evictions());
+                int budgetMB = (int)(textureLoader.budget() >> 20);
+                ImGui::SetNextItemWidth(120);
+                if (ImGui::InputInt("Texture budget (MB)", &budgetMB)) textureLoader.setBudget((size_t)std::max(budgetMB, 1) << 20);
+                if (g_Batched && !scene.batchers.empty()) {
+                    // summed over the items, one batch each
+                    size_t commands = 0, visible = 0, total = 0, rebuilt = 0;
+                    double buildMs = 0.0;
+                    for (const DrawItem& item : scene.items) {
+                        if (!item.batch) continue;
+                        commands += item.batch->commands().size();
+                        visible += item.batch->visibleObjects();
+                        total += item.batch->totalObjects();
+                        buildMs += item.batch->buildMs();
+                        rebuilt += !item.batch->reused();
+                    }
+                    ImGui::Text("Batch: %zu commands, %zu of %zu objects visible, build %.3f ms, %zu of %zu rebuilt (%s)",
+                        commands, visible, total, buildMs, rebuilt, scene.items.size(),
+                        scene.batchers[0].multiDraw() ? "multi-draw indirect" : "GL 3.3 loop");
+                }
+                if (g_LightCulling)
+                    ImGui::Text("Lights reaching the model: %zu of %zu", scene.frameLights->size(), lights.size());
+                if (g_Shadows)
+                    ImGui::Text("Shadow cascades: %.1f re-renders/s, %d of %d cached this frame",
+                        g_ShadowRendersPerSec, shadowCascades.cachedCascades(), ShadowCascades::CASCADES);
+                if (g_RenderPath == RenderPath::TiledDeferred && deferredRenderer.ready()) {
+                    ImGui::Text("Tiles: %d (%dx%d px), %zu lights, shade submit %.3f ms", deferredRenderer.tileCount(),
+                        DeferredRenderer::TILE_SIZE, DeferredRenderer::TILE_SIZE, scene.frameLights->size(), deferredRenderer.shadeCpuMs());
+                    if (deferredRenderer.overflowTiles() > 0)
+                        ImGui::TextColored(ImVec4(1, 0.7f, 0, 1), "%d tiles over %d lights, %d tile lights dropped",
+                            deferredRenderer.overflowTiles(), DeferredRenderer::MAX_TILE_LIGHTS, deferredRenderer.droppedLights());
+                } else if (g_RenderPath == RenderPath::Clustered) {
+                    ImGui::Text("Clusters: %dx%dx%d, build %.3f ms", LightClusters::DIM_X,
+                        LightClusters::DIM_Y, LightClusters::DIM_Z, lightClusters.buildMs());
+                    ImGui::Text("Lights/cluster: avg %.2f, max %d (%d occupied)",
+                        lightClusters.avgLightsPerCluster(), lightClusters.maxLightsPerCluster(),
+                        lightClusters.occupiedClusters());
+                    if (lightClusters.droppedLights() > 0)
+                        ImGui::TextColored(ImVec4(1, 0.7f, 0, 1), "%d lights dropped at the texture buffer limit",
+                            lightClusters.droppedLights());
+                } else {
+                    glm::ivec3 tc = lightBuffer.typeCounts();
+                    ImGui::Text("Forward lights: %d dir, %d point, %d spot", tc.x, tc.y, tc.z);
+                    ImGui::Text("Light buffer: %d dirty, %zu bytes uploaded",
+                        lightBuffer.lastDirtyLights(), lightBuffer.lastUploadBytes());
+                    if ((int)scene.frameLights->size() > MAX_LIGHTS)
+                        ImGui::TextColored(ImVec4(1, 0.7f, 0, 1), "Forward path shades only the first %d of %zu lights",
+                            MAX_LIGHTS, scene.frameLights->size());
+                }
+
+                auto listVariants = [](const char* label, const auto& perms) {
+                    if (ImGui::TreeNode(label)) {
+                        for (const auto* v : perms.compiled()) {
+                            std::string d;
+                            for (size_t at = 0; (at = v->defines.find("#define ", at)) != std::string::npos; ) {
+                                size_t eol = v->defines.find('\n', at);
+                                d += v->defines.substr(at + 8, eol - at - 8) + "  ";
+                                at = eol;
+                            }
+                            ImGui::Text("%7.2f ms  %s", v->compileMs, d.empty() ? "(none)" : d.c_str());
+                        }
+                        ImGui::TreePop();
+                    }
+                };
+                ImGui::Separator();
+                ImGui::Text("Shader permutations: %zu forward, %zu G-buffer",
+                    scene.forwardShaders.compiled().size(), scene.gbufferShaders.compiled().size());
+                listVariants("Forward variants", scene.forwardShaders);
+                listVariants("G-buffer variants", scene.gbufferShaders);
 
                 //  
                 std::string V = vendor ? vendor : "";
@@ -532,18 +1438,31 @@ int main() {
         }
         ImGui::End();
 
+        draw_profiler_window();
+
+        {
+            Profiler::Scope zone(profiler, "ImGui render", true);
 // ImGui: render the UI draw data.
-        gui.endFrame();
+            gui.endFrame();
+        }
 #endif
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        {
+            Profiler::Scope zone(profiler, "swap");
+            glfwSwapBuffers(window);
+        }
+        {
+            Profiler::Scope zone(profiler, "input");
+            glfwPollEvents();
+        }
+        profiler.endFrame();
     }
 
+    profiler.shutdown();
 #ifdef USE_IMGUI
-    if (g_HasTimerQuery) glDeleteQueries(2, g_TimerQuery);
     gui.shutdown();
 #endif
+    g_SceneObjects.clear();  // their instance buffers, while the context is still current
     glfwTerminate();
     return 0;
 }
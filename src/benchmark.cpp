@@ -0,0 +1,229 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#include <GLFW/glfw3.h>
+#endif
+
+// ---------- command line ----------
+bool parseBenchmarkArgs(int argc, char** argv, BenchmarkOptions& options, bool& valid) {
+    valid = true;
+    bool benchmark = false;
+    const char* unknown = nullptr;  // an error only for the benchmark: the window ignores e.g. a file dropped on the exe
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto takes = [&](bool ok) {
+            if (!value || !ok) { std::cout << "ERROR::BENCHMARK::BAD_ARGUMENT: " << arg << std::endl; valid = false; }
+            ++i;
+        };
+        if (!std::strcmp(arg, "--benchmark")) benchmark = true;
+        else if (!std::strcmp(arg, "--model")) { if (value) options.model = value; takes(true); }
+        else if (!std::strcmp(arg, "--normal-map")) { if (value) options.normalMap = value; takes(true); }
+        else if (!std::strcmp(arg, "--scene")) { if (value) options.scene = value; takes(true); }
+        else if (!std::strcmp(arg, "--path")) {
+            if (value) options.path = value;
+            takes(options.path == "forward" || options.path == "clustered" || options.path == "deferred");
+        }
+        else if (!std::strcmp(arg, "--out")) { if (value) options.output = value; takes(true); }
+        else if (!std::strcmp(arg, "--lights")) takes(value && std::sscanf(value, "%d", &options.lights) == 1 && options.lights >= 0);
+        else if (!std::strcmp(arg, "--instances")) takes(value && std::sscanf(value, "%d", &options.instances) == 1 && options.instances >= 0);
+        else if (!std::strcmp(arg, "--frames")) takes(value && std::sscanf(value, "%d", &options.frames) == 1 && options.frames > 0);
+        else if (!std::strcmp(arg, "--warmup")) takes(value && std::sscanf(value, "%d", &options.warmup) == 1 && options.warmup >= 0);
+        else if (!std::strcmp(arg, "--size"))
+            takes(value && std::sscanf(value, "%dx%d", &options.width, &options.height) == 2 && options.width > 0 && options.height > 0);
+        else if (!std::strcmp(arg, "--orbit-distance")) takes(value && std::sscanf(value, "%f", &options.orbitDistance) == 1);
+        else if (!std::strcmp(arg, "--orbit-pitch")) takes(value && std::sscanf(value, "%f", &options.orbitPitch) == 1);
+        else if (!std::strcmp(arg, "--orbit-turns")) takes(value && std::sscanf(value, "%f", &options.orbitTurns) == 1);
+        else if (!unknown) unknown = arg;
+    }
+    if (benchmark && unknown) {
+        std::cout << "ERROR::BENCHMARK::UNKNOWN_ARGUMENT: " << unknown << std::endl;
+        valid = false;
+    }
+    if (benchmark && options.model.empty() && options.scene.empty()) {
+        std::cout << "ERROR::BENCHMARK::NO_MODEL: pass --model <file> or --scene <file>" << std::endl;
+        valid = false;
+    }
+    return benchmark;
+}
+
+// ---------- headless context ----------
+HeadlessContext::~HeadlessContext() {
+    destroy();
+}
+
+bool HeadlessContext::create(int width, int height) {
+    width_ = width; height_ = height;
+#ifdef __linux__
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (dpy == EGL_NO_DISPLAY) dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_API)) {
+        std::cout << "ERROR::BENCHMARK::EGL_INIT: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        return false;
+    }
+    display_ = dpy;
+    EGLContext ctx = EGL_NO_CONTEXT;
+    for (int version : { 43, 33 }) {  // surfaceless + no config: there is nothing to render to but FBOs
+        EGLint attribs[] = { EGL_CONTEXT_MAJOR_VERSION, version / 10, EGL_CONTEXT_MINOR_VERSION, version % 10,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+        ctx = eglCreateContext(dpy, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attribs);
+        if (ctx != EGL_NO_CONTEXT) break;
+    }
+    if (ctx == EGL_NO_CONTEXT || !eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx)) {
+        std::cout << "ERROR::BENCHMARK::EGL_CONTEXT: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+        return false;
+    }
+    context_ = ctx;
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) return false;
+#else
+    if (!glfwInit()) return false;
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "8Phong benchmark", nullptr, nullptr);
+    if (!window) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(64, 64, "8Phong benchmark", nullptr, nullptr);
+    }
+    if (!window) { std::cout << "ERROR::BENCHMARK::CONTEXT" << std::endl; return false; }
+    display_ = window;
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) return false;
+#endif
+
+    glGenRenderbuffers(1, &color_);
+    glBindRenderbuffer(GL_RENDERBUFFER, color_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depth_);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glGenFramebuffers(1, &fbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::BENCHMARK::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        return false;
+    }
+    bind();
+    return true;
+}
+
+void HeadlessContext::destroy() {
+    if (!display_) return;
+    if (context_ || fbo_) {  // GL objects only while the context is still current
+        for (GLsync& f : fences_) if (f) { glDeleteSync(f); f = nullptr; }
+        if (fbo_) glDeleteFramebuffers(1, &fbo_);
+        if (color_) glDeleteRenderbuffers(1, &color_);
+        if (depth_) glDeleteRenderbuffers(1, &depth_);
+        fbo_ = color_ = depth_ = 0;
+    }
+#ifdef __linux__
+    eglMakeCurrent((EGLDisplay)display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (context_) eglDestroyContext((EGLDisplay)display_, (EGLContext)context_);
+    eglTerminate((EGLDisplay)display_);
+#else
+    glfwDestroyWindow((GLFWwindow*)display_);
+    glfwTerminate();
+#endif
+    display_ = context_ = nullptr;
+}
+
+void HeadlessContext::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glViewport(0, 0, width_, height_);
+}
+
+void HeadlessContext::present() {
+    GLsync& slot = fences_[frame_++ % FRAMES_IN_FLIGHT];
+    if (slot) {
+        glClientWaitSync(slot, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(slot);
+    }
+    slot = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+}
+
+// ---------- report ----------
+BenchmarkStats benchmarkStats(std::vector<double> ms) {
+    ms.erase(std::remove_if(ms.begin(), ms.end(), [](double v) { return v < 0.0; }), ms.end());
+    BenchmarkStats s;
+    s.count = ms.size();
+    if (ms.empty()) return s;
+    std::sort(ms.begin(), ms.end());
+    double sum = 0.0;
+    for (double v : ms) sum += v;
+    auto rank = [&](double p) { return ms[(size_t)std::max(std::ceil(p / 100.0 * ms.size()) - 1.0, 0.0)]; };
+    s.mean = sum / ms.size();
+    s.p50 = rank(50.0); s.p95 = rank(95.0); s.p99 = rank(99.0);
+    s.max = ms.back();
+    return s;
+}
+
+static std::string jsonString(const std::string& v) {
+    std::string out = "\"";
+    for (char c : v) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if ((unsigned char)c < 0x20) { char esc[8]; std::snprintf(esc, sizeof(esc), "\\u%04x", c); out += esc; }
+        else out += c;
+    }
+    return out + "\"";
+}
+
+bool writeBenchmarkReport(const BenchmarkOptions& options, const std::string& renderer,
+                          const std::vector<BenchmarkSample>& samples) {
+    std::vector<double> frame, cpu, gpu;
+    for (const BenchmarkSample& s : samples) { frame.push_back(s.frameMs); cpu.push_back(s.cpuMs); gpu.push_back(s.gpuMs); }
+    struct Metric { const char* name; BenchmarkStats stats; };
+    const Metric metrics[] = { { "frame_ms", benchmarkStats(frame) }, { "cpu_ms", benchmarkStats(cpu) }, { "gpu_ms", benchmarkStats(gpu) } };
+
+    char line[256];
+    std::cout << "BENCHMARK: " << samples.size() << " frames at " << options.width << "x" << options.height
+        << ", " << options.path << ", " << renderer << std::endl;
+    for (const Metric& m : metrics) {
+        std::snprintf(line, sizeof(line), "  %-8s n=%zu mean %.3f p50 %.3f p95 %.3f p99 %.3f max %.3f", m.name,
+            m.stats.count, m.stats.mean, m.stats.p50, m.stats.p95, m.stats.p99, m.stats.max);
+        std::cout << line << std::endl;
+    }
+
+    std::ofstream out(options.output, std::ios::trunc);
+    const bool csv = options.output.size() >= 4 && options.output.compare(options.output.size() - 4, 4, ".csv") == 0;
+    if (csv) {
+        out << "metric,frames,mean,p50,p95,p99,max\n";
+        for (const Metric& m : metrics) {
+            std::snprintf(line, sizeof(line), "%s,%zu,%.4f,%.4f,%.4f,%.4f,%.4f\n", m.name, m.stats.count,
+                m.stats.mean, m.stats.p50, m.stats.p95, m.stats.p99, m.stats.max);
+            out << line;
+        }
+    } else {
+        out << "{\n  \"model\": " << jsonString(options.model) << ",\n  \"normal_map\": " << jsonString(options.normalMap)
+            << ",\n  \"scene\": " << jsonString(options.scene)
+            << ",\n  \"path\": " << jsonString(options.path) << ",\n  \"renderer\": " << jsonString(renderer)
+            << ",\n  \"width\": " << options.width << ",\n  \"height\": " << options.height
+            << ",\n  \"lights\": " << options.lights << ",\n  \"instances\": " << options.instances
+            << ",\n  \"frames\": " << samples.size();
+        for (const Metric& m : metrics) {
+            std::snprintf(line, sizeof(line), ",\n  \"%s\": { \"frames\": %zu, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }",
+                m.name, m.stats.count, m.stats.mean, m.stats.p50, m.stats.p95, m.stats.p99, m.stats.max);
+            out << line;
+        }
+        out << "\n}\n";
+    }
+    if (!out) { std::cout << "ERROR::BENCHMARK::WRITE_FAILED: " << options.output << std::endl; return false; }
+    std::cout << "BENCHMARK: report written to " << options.output << std::endl;
+    return true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// Headless benchmark mode (8Phong --benchmark ...): renders a scripted camera orbit into an
+// offscreen framebuffer, with no window and no dialogs, and reports frame-time percentiles.
+struct BenchmarkOptions {
+    std::string model, normalMap;
+    std::string scene;                // scene file instead of --model; also opens in the window without --benchmark
+    std::string path = "forward";     // forward | clustered | deferred
+    std::string output = "benchmark.json";  // .csv or .json
+    int   lights = 0;                 // point lights scattered on top of the startup set
+    int   instances = 0;              // > 0: instanced stress grid of that many copies
+    int   frames = 600, warmup = 60;  // measured frames, and frames rendered before them
+    int   width = 1280, height = 720;
+    float orbitDistance = 0.0f;       // 0 = three times the radius of the model (or grid)
+    float orbitPitch = 20.0f;         // degrees above the orbit center
+    float orbitTurns = 1.0f;          // full turns over the measured frames
+};
+
+// True when the command line asks for the benchmark; fills `options` (only `scene` applies to
+// the windowed app). A malformed argument, or an unknown one with --benchmark, is reported and
+// clears `valid`; without --benchmark unknown arguments are ignored.
+bool parseBenchmarkArgs(int argc, char** argv, BenchmarkOptions& options, bool& valid);
+
+// A GL context with no window: surfaceless EGL on Linux (Mesa llvmpipe on a GPU-less
+// machine), a hidden GLFW window elsewhere. Renders into its own framebuffer of the
+// requested size; present() stands in for a double-buffered swap.
+class HeadlessContext {
+public:
+    static const int FRAMES_IN_FLIGHT = 2;
+
+    ~HeadlessContext();
+    // Prefers GL 4.3 core, falls back to 3.3; makes the context current and loads GL.
+    bool create(int width, int height);
+    void destroy();
+
+    void bind() const;  // the offscreen framebuffer and its viewport
+    // Ends a frame: waits until the frame FRAMES_IN_FLIGHT back has finished on the GPU,
+    // so the CPU cannot run ahead of it without bound.
+    void present();
+
+private:
+    void*  display_ = nullptr;  // EGLDisplay / EGLContext, or the hidden GLFWwindow*
+    void*  context_ = nullptr;
+    GLuint fbo_ = 0, color_ = 0, depth_ = 0;
+    int    width_ = 0, height_ = 0;
+    GLsync fences_[FRAMES_IN_FLIGHT] = {};
+    int    frame_ = 0;
+};
+
+// One measured frame: wall time, CPU time outside present(), and GPU time (< 0 if unknown).
+struct BenchmarkSample { double frameMs, cpuMs, gpuMs; };
+struct BenchmarkStats { size_t count = 0; double mean = 0, p50 = 0, p95 = 0, p99 = 0, max = 0; };
+
+// Nearest-rank percentiles of the non-negative values.
+BenchmarkStats benchmarkStats(std::vector<double> ms);
+
+// Prints the summary and writes options.output as CSV or JSON (by extension).
+// Returns false (and logs) if the file could not be written.
+bool writeBenchmarkReport(const BenchmarkOptions& options, const std::string& renderer,
+                          const std::vector<BenchmarkSample>& samples);
+
+#endif
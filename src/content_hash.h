@@ -0,0 +1,16 @@
+#pragma once
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit FNV-1a, chainable through `seed`. Keys the on-disk caches by source content and settings.
+inline std::uint64_t hashBytes(const void* data, size_t bytes, std::uint64_t seed=1469598103934665603ull){
+    const unsigned char* p=(const unsigned char*)data;
+    std::uint64_t h=seed;
+    for(size_t i=0;i<bytes;i++){ h^=p[i]; h*=1099511628211ull; }
+    return h;
+}
+
+#endif
@@ -0,0 +1,172 @@
+#include "deferred_renderer.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+DeferredRenderer::~DeferredRenderer() {
+    delete computeShader_;
+}
+
+static GLuint makeTarget(GLenum internalFormat, GLenum format, GLenum type, int w, int h) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format, type, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return tex;
+}
+
+bool DeferredRenderer::init(int width, int height) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major < 4 || (major == 4 && minor < 3) || !glad_glDispatchCompute) return false;
+
+    computeShader_ = new Shader("shaders/tiled_deferred.compute.shader");
+    uView_          = computeShader_->uniform<glm::mat4>("view"_u);
+    uInvProjection_ = computeShader_->uniform<glm::mat4>("invProjection"_u);
+    uInvView_       = computeShader_->uniform<glm::mat4>("invView"_u);
+    uViewPos_       = computeShader_->uniform<glm::vec3>("viewPos"_u);
+    uClearColor_    = computeShader_->uniform<glm::vec3>("clearColor"_u);
+    uScreenSize_    = computeShader_->uniform<glm::ivec2>("screenSize"_u);
+    uShadowLightSpace_ = computeShader_->uniform<glm::mat4>("shadowLightSpace"_u);
+    uShadowSplits_     = computeShader_->uniform<glm::vec4>("shadowSplits"_u);
+    uShadowLight_      = computeShader_->uniform<int>("shadowLight"_u);
+
+    glGenBuffers(1, &lightSsbo_);
+    glGenBuffers(STATS_RING, statsSsbo_);
+    for (GLuint buf : statsSsbo_) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    resize(width, height);
+    return true;
+}
+
+void DeferredRenderer::releaseTargets() {
+    GLuint tex[] = { depthTex_, normalTex_, albedoTex_, outputTex_ };
+    if (depthTex_) glDeleteTextures(4, tex);
+    if (gbufferFbo_) { glDeleteFramebuffers(1, &gbufferFbo_); glDeleteFramebuffers(1, &outputFbo_); }
+    depthTex_ = normalTex_ = albedoTex_ = outputTex_ = gbufferFbo_ = outputFbo_ = 0;
+}
+
+void DeferredRenderer::resize(int width, int height) {
+    if (width == width_ && height == height_) return;
+    releaseTargets();
+    width_ = width; height_ = height;
+    tilesX_ = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY_ = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    depthTex_  = makeTarget(GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, width, height);
+    normalTex_ = makeTarget(GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, width, height);
+    albedoTex_ = makeTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+    outputTex_ = makeTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+
+    glGenFramebuffers(1, &gbufferFbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, gbufferFbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTex_, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, normalTex_, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, albedoTex_, 0);
+    GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, drawBuffers);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "ERROR::DEFERRED::GBUFFER_INCOMPLETE" << std::endl;
+
+    glGenFramebuffers(1, &outputFbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, outputFbo_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, outputTex_, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Takes the counters of the dispatch that last used this slot if it has finished; a slot
+// still in flight after STATS_RING frames is dropped rather than waited for.
+void DeferredRenderer::readStats(int slot) {
+    GLsync& fence = statsFence_[slot];
+    if (!fence) return;
+    if (glClientWaitSync(fence, 0, 0) != GL_TIMEOUT_EXPIRED) {
+        GLuint counts[2];
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsSsbo_[slot]);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(counts), counts);
+        overflowTiles_ = (int)counts[0];
+        droppedLights_ = (int)counts[1];
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void DeferredRenderer::beginGeometryPass() {
+    GLint target = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &target);  // the window, or the benchmark's offscreen target
+    targetFbo_ = (GLuint)target;
+    glBindFramebuffer(GL_FRAMEBUFFER, gbufferFbo_);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void DeferredRenderer::endGeometryPass() {
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFbo_);
+}
+
+void DeferredRenderer::shade(const std::vector<LightCPU>& lights, const glm::mat4& view, const glm::mat4& projection,
+                             const glm::vec3& viewPos, const glm::vec3& clearColor, const ShadowCascades* shadows,
+                             float cutoff) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    // header + packed lights, one buffer update
+    size_t n = lights.size();
+    staging_.resize(sizeof(LightHeader) + n * sizeof(LightGPU));
+    LightHeader header{ glm::ivec4((int)n, 0, 0, 0) };
+    std::memcpy(staging_.data(), &header, sizeof(header));
+    LightGPU* dst = reinterpret_cast<LightGPU*>(staging_.data() + sizeof(LightHeader));
+    for (size_t i = 0; i < n; ++i) dst[i] = packLight(lights[i], cutoff);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightSsbo_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)staging_.size(), staging_.data(), GL_STREAM_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, lightSsbo_);
+
+    readStats(statsSlot_);
+    const GLuint zero[2] = { 0, 0 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsSsbo_[statsSlot_]);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), zero);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, STATS_BINDING, statsSsbo_[statsSlot_]);
+
+    computeShader_->use();
+    computeShader_->set(uView_, view);
+    computeShader_->set(uInvProjection_, glm::inverse(projection));
+    computeShader_->set(uInvView_, glm::inverse(view));
+    computeShader_->set(uViewPos_, viewPos);
+    computeShader_->set(uClearColor_, clearColor);
+    computeShader_->set(uScreenSize_, glm::ivec2(width_, height_));
+
+    int shadowLight = -1;
+    if (shadows) {
+        for (size_t i = 0; i < n && shadowLight < 0; ++i)
+            if (lights[i].type == LightType::Directional) shadowLight = (int)i;
+        computeShader_->set(uShadowLightSpace_, shadows->lightSpace(), ShadowCascades::CASCADES);
+        computeShader_->set(uShadowSplits_, shadows->splits());
+        shadows->bind();
+    }
+    computeShader_->set(uShadowLight_, shadowLight);
+
+    glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, depthTex_);
+    glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, normalTex_);
+    glActiveTexture(GL_TEXTURE2); glBindTexture(GL_TEXTURE_2D, albedoTex_);
+    glActiveTexture(GL_TEXTURE0);
+    glBindImageTexture(0, outputTex_, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+    glDispatchCompute((GLuint)tilesX_, (GLuint)tilesY_, 1);
+    glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    statsFence_[statsSlot_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    statsSlot_ = (statsSlot_ + 1) % STATS_RING;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, outputFbo_);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFbo_);
+    glBlitFramebuffer(0, 0, width_, height_, 0, 0, width_, height_, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFbo_);
+
+    shadeCpuMs_ = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+}
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "lighting.h"
+#include "shader.h"
+#include "shadow_cascades.h"
+
+// Tiled deferred path: a G-buffer pass (normal + shininess, albedo, depth) followed by a
+// compute pass that culls lights per 16x16 screen tile and accumulates Phong lighting
+// only for the lights touching each tile. Needs a GL 4.3 context (compute + SSBO).
+class DeferredRenderer {
+public:
+    static const int TILE_SIZE = 16;        // must match local_size in the compute shader
+    static const GLuint LIGHT_BINDING = 1;  // SSBO binding of LightList
+    static const GLuint STATS_BINDING = 2;  // SSBO binding of TileStats
+    static const int MAX_TILE_LIGHTS = 512; // must match MAX_TILE_LIGHTS in the compute shader
+
+    ~DeferredRenderer();
+
+    // Compiles the compute pass and allocates the G-buffer; returns false if compute is unavailable.
+    // The G-buffer program (gbuffer.fragment.shader) is owned by the caller's permutation cache.
+    bool init(int width, int height);
+    bool ready() const { return computeShader_ != nullptr; }
+    void resize(int width, int height);
+
+    // Draw geometry with a G-buffer program between beginGeometryPass/endGeometryPass.
+    void beginGeometryPass();
+    void endGeometryPass();
+
+    // Culls + shades into the output image and blits it to the framebuffer that was bound at
+    // beginGeometryPass (normally the default one).
+    // With shadows, the first directional light is attenuated by its cascades.
+    // Tile culling uses lightRange(L, cutoff).
+    void shade(const std::vector<LightCPU>& lights, const glm::mat4& view, const glm::mat4& projection,
+               const glm::vec3& viewPos, const glm::vec3& clearColor, const ShadowCascades* shadows = nullptr,
+               float cutoff = LIGHT_CUTOFF);
+
+    double shadeCpuMs() const { return shadeCpuMs_; }
+    int    tileCount() const { return tilesX_ * tilesY_; }
+    // Tiles that hit MAX_TILE_LIGHTS and the lights they left out, from the newest
+    // shade() whose results reached the CPU (a few frames late; reading never stalls).
+    int    overflowTiles() const { return overflowTiles_; }
+    int    droppedLights() const { return droppedLights_; }
+
+private:
+    struct LightHeader { glm::ivec4 count; };
+    static const int STATS_RING = 3;  // TileStats buffers in flight
+
+    Shader* computeShader_ = nullptr;
+    GLuint  gbufferFbo_ = 0, outputFbo_ = 0, targetFbo_ = 0;
+    GLuint  depthTex_ = 0, normalTex_ = 0, albedoTex_ = 0, outputTex_ = 0;
+    GLuint  lightSsbo_ = 0;
+    int     width_ = 0, height_ = 0, tilesX_ = 0, tilesY_ = 0;
+    std::vector<unsigned char> staging_;
+    double  shadeCpuMs_ = 0.0;
+    GLuint  statsSsbo_[STATS_RING] = {};
+    GLsync  statsFence_[STATS_RING] = {};
+    int     statsSlot_ = 0;
+    int     overflowTiles_ = 0, droppedLights_ = 0;
+
+    Uniform<glm::mat4>  uView_, uInvProjection_, uInvView_;
+    Uniform<glm::vec3>  uViewPos_, uClearColor_;
+    Uniform<glm::ivec2> uScreenSize_;
+    Uniform<glm::mat4>  uShadowLightSpace_;
+    Uniform<glm::vec4>  uShadowSplits_;
+    Uniform<int>        uShadowLight_;
+
+    void releaseTargets();
+    void readStats(int slot);
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include "draw_batcher.h"
+#include <algorithm>
+#include <chrono>
+
+void DrawBatcher::init() {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    multiDraw_ = (major > 4 || (major == 4 && minor >= 3)) && glad_glMultiDrawElementsIndirect;
+    glGenBuffers(1, &instanceBuffer_);
+    if (multiDraw_) glGenBuffers(1, &indirectBuffer_);
+}
+
+// Gribb-Hartmann planes of a clip matrix, normalized so distances are in world units.
+static void frustumPlanes(const glm::mat4& m, glm::vec4 planes[6]) {
+    glm::vec4 r0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 r1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 r2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 r3(m[0][3], m[1][3], m[2][3], m[3][3]);
+    planes[0] = r3 + r0; planes[1] = r3 - r0;
+    planes[2] = r3 + r1; planes[3] = r3 - r1;
+    planes[4] = r3 + r2; planes[5] = r3 - r2;
+    for (int i = 0; i < 6; ++i) planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+static bool sphereVisible(const glm::vec4 planes[6], const glm::vec3& c, float r) {
+    for (int i = 0; i < 6; ++i)
+        if (glm::dot(glm::vec3(planes[i]), c) + planes[i].w < -r) return false;
+    return true;
+}
+
+static float maxScale(const glm::mat4& m) {
+    return std::sqrt(std::max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+        std::max(glm::dot(glm::vec3(m[1]), glm::vec3(m[1])), glm::dot(glm::vec3(m[2]), glm::vec3(m[2])))));
+}
+
+void DrawBatcher::build(const Model& m, const InstanceSet* instances, const glm::mat4& model, const glm::mat4& viewProj,
+                        const LodView& lodView) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    const bool instanced = instances != nullptr;
+    reused_ = valid_ && builtModel_ == &m && builtSet_ == instances && builtTransform_ == model &&
+        builtViewProj_ == viewProj && builtLodView_.viewPos == lodView.viewPos &&
+        builtLodView_.pixelsPerUnit == lodView.pixelsPerUnit && builtLodView_.maxPixelError == lodView.maxPixelError &&
+        (!instanced || builtInstances_ == instances->version);
+    if (reused_) {
+        buildMs_ = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+        return;
+    }
+    valid_ = true;
+    builtModel_ = &m;
+    builtSet_ = instances;
+    builtInstances_ = instanced ? instances->version : 0;
+    builtTransform_ = model;
+    builtViewProj_ = viewProj;
+    builtLodView_ = lodView;
+    instanced_ = instanced;
+    commands_.clear();
+    visible_.clear();
+    visibleLod_.clear();
+    std::fill(std::begin(lodObjects_), std::end(lodObjects_), 0);
+    lod0Triangles_ = 0;
+
+    glm::vec4 planes[6];
+    frustumPlanes(viewProj, planes);
+    glm::vec3 center = glm::vec3(model * glm::vec4(m.boundsCenter, 1.0f));
+    float radius = m.boundsRadius * maxScale(model);
+
+    if (instanced) {
+        // instances are culled whole, then sorted by LOD (counting sort) so each LOD's
+        // instances are one contiguous baseInstance range
+        totalObjects_ = instances->data.size();
+        visible_.reserve(totalObjects_);
+        for (const auto& inst : instances->data) {
+            glm::vec3 c = glm::vec3(inst.Model * glm::vec4(center, 1.0f));
+            float s = maxScale(inst.Model);
+            if (!sphereVisible(planes, c, radius * s)) continue;
+            int lod = m.selectLod(lodView, c, radius * s, s * maxScale(model));
+            visible_.push_back(inst);
+            visibleLod_.push_back((unsigned char)lod);
+            lodObjects_[lod]++;
+        }
+        size_t lodStart[Submesh::MAX_LODS] = {};
+        for (int l = 1; l < m.lodCount; ++l) lodStart[l] = lodStart[l - 1] + lodObjects_[l - 1];
+        for (int l = 0; l < m.lodCount; ++l) {
+            if (!lodObjects_[l]) continue;
+            for (const auto& sm : m.submeshes)
+                commands_.push_back(DrawCommand{ sm.lods[l].indexCount, (GLuint)lodObjects_[l], sm.lods[l].firstIndex,
+                    sm.baseVertex, (GLuint)lodStart[l] });
+        }
+        lod0Triangles_ = visible_.size() * m.triangleCount();
+        sorted_.resize(visible_.size());
+        for (size_t i = 0; i < visible_.size(); ++i) sorted_[lodStart[visibleLod_[i]]++] = visible_[i];
+        visible_.swap(sorted_);
+    } else {
+        // a single object: cull it, then each of its submeshes
+        totalObjects_ = m.submeshes.size();
+        if (sphereVisible(planes, center, radius)) {
+            float scale = maxScale(model);
+            for (const auto& sm : m.submeshes) {
+                glm::vec3 c = glm::vec3(model * glm::vec4(sm.boundsCenter, 1.0f));
+                if (!sphereVisible(planes, c, sm.boundsRadius * scale)) continue;
+                int lod = m.selectLod(lodView, c, sm.boundsRadius * scale, scale);
+                commands_.push_back(DrawCommand{ sm.lods[lod].indexCount, 1, sm.lods[lod].firstIndex, sm.baseVertex, 0 });
+                visible_.push_back(InstanceData{ glm::mat4(1.0f), glm::vec4(1.0f) });
+                lodObjects_[lod]++;
+                lod0Triangles_ += sm.indexCount / 3;
+            }
+        }
+    }
+    triangles_ = 0;
+    for (const auto& c : commands_) triangles_ += (size_t)c.count / 3 * c.instanceCount;
+
+    if (instanced && !visible_.empty()) {
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+        glBufferData(GL_ARRAY_BUFFER, visible_.size() * sizeof(InstanceData), visible_.data(), GL_STREAM_DRAW);
+    }
+    if (multiDraw_ && !commands_.empty()) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer_);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands_.size() * sizeof(DrawCommand), commands_.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    buildMs_ = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+}
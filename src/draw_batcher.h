@@ -0,0 +1,72 @@
+#pragma once
+#ifndef DRAW_BATCHER_H
+#define DRAW_BATCHER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "model.h"
+
+// Layout of one glMultiDrawElementsIndirect record.
+struct DrawCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+};
+
+// Collects the visible draws of a model's submeshes into one indirect command list. Instances are
+// frustum-culled on the CPU and compacted into a buffer that the commands address through
+// baseInstance, so the whole batch is a single glMultiDrawElementsIndirect on GL 4.3 and
+// a short glDrawElementsInstancedBaseVertex loop on GL 3.3 (see Model::DrawBatch).
+class DrawBatcher {
+public:
+    void init();
+    bool multiDraw() const { return multiDraw_; }
+
+    // Culls against viewProj * model and uploads the commands plus visible instance data.
+    // Every visible object also picks its LOD from lodView. With `instances`, the visible ones
+    // are grouped by LOD, one command per (LOD, submesh). Without (nullptr), the objects are the
+    // model's submeshes, one command each.
+    // The cull is O(instances) on the CPU, so a call with the same model, instances, matrices
+    // and LOD view as the previous one keeps the uploaded batch and returns at once.
+    void build(const Model& m, const InstanceSet* instances, const glm::mat4& model, const glm::mat4& viewProj,
+               const LodView& lodView = LodView());
+
+    const std::vector<DrawCommand>& commands() const { return commands_; }
+    bool   instanced() const { return instanced_; }
+    GLuint instanceBuffer() const { return instanceBuffer_; }
+    GLuint indirectBuffer() const { return indirectBuffer_; }
+
+    // Stats of the most recent build() (objects = instances, or submeshes without instancing).
+    size_t visibleObjects() const { return visible_.size(); }
+    size_t totalObjects() const { return totalObjects_; }
+    size_t lodObjects(int lod) const { return lodObjects_[lod]; }
+    size_t triangles() const { return triangles_; }  // submitted, over all instances
+    size_t lod0Triangles() const { return lod0Triangles_; }  // the same draws at LOD 0
+    double buildMs() const { return buildMs_; }
+    bool   reused() const { return reused_; }  // the last build() kept the previous batch
+
+private:
+    bool   multiDraw_ = false;
+    bool   instanced_ = false;
+    GLuint instanceBuffer_ = 0, indirectBuffer_ = 0;
+    std::vector<DrawCommand>  commands_;
+    std::vector<InstanceData> visible_, sorted_;
+    std::vector<unsigned char> visibleLod_;
+    size_t totalObjects_ = 0;
+    size_t lodObjects_[Submesh::MAX_LODS] = {};
+    size_t triangles_ = 0, lod0Triangles_ = 0;
+    double buildMs_ = 0.0;
+
+    // inputs of the batch currently uploaded
+    bool               valid_ = false, reused_ = false;
+    const Model*       builtModel_ = nullptr;
+    const InstanceSet* builtSet_ = nullptr;  // null: not instanced
+    unsigned           builtInstances_ = 0;
+    glm::mat4          builtTransform_{ 0.0f }, builtViewProj_{ 0.0f };
+    LodView            builtLodView_;
+};
+
+#endif
@@ -1,7 +1,8 @@
 /*
  * Annotated for clarity:
  *  - This project implements Phong shading with optional normal mapping,
- *    supports up to 8 lights (directional/point/spot), and uses ImGui for GUI.
+ *    supports up to 8 lights (directional/point/spot) on the forward path and
+ *    thousands with clustered forward shading, and uses ImGui for GUI.
  */
 
 #include "gui_panel.h"
@@ -16,8 +17,11 @@
 static inline float Deg2Rad(float d) { return d * 3.1415926535f / 180.0f; }
 static inline float Rad2Deg(float r) { return r * 180.0f / 3.1415926535f; }
 
+// Above this many lights only the selected light gets an editor.
+static const int MAX_LISTED_LIGHTS = 16;
+
 GuiPanel::GuiPanel(GLFWwindow* window,
-    glm::vec3& objectColor, float& shininess, bool& useNormalMap,
+    glm::vec3& objectColor, float& shininess, bool& useNormalMap, bool& flipNormalY,
     std::vector<LightCPU>& lights,
     glm::vec3& camPosRef, glm::vec3& camDirRef,
     bool& showLightGizmos,
@@ -26,7 +30,7 @@ GuiPanel::GuiPanel(GLFWwindow* window,
     float& rotateSpeed,
     glm::vec3& orbitCenterRef)
     : window_(window),
-    objectColor_(objectColor), shininess_(shininess), useNormalMap_(useNormalMap),
+    objectColor_(objectColor), shininess_(shininess), useNormalMap_(useNormalMap), flipNormalY_(flipNormalY),
     lights_(lights), camPosRef_(camPosRef), camDirRef_(camDirRef),
     showLightGizmos_(showLightGizmos),
     rotateEnabled_(rotateEnabled), rotX_(rotX), rotY_(rotY), rotZ_(rotZ), rotateSpeed_(rotateSpeed),
@@ -61,7 +65,7 @@ void GuiPanel::endFrame() {
 }
 
 void GuiPanel::addLight(int type) {
-    if ((int)lights_.size() >= 8) return;
+    if ((int)lights_.size() >= MAX_CLUSTERED_LIGHTS) return;
     LightCPU L{};
     L.type = static_cast<LightType>(type);
     L.position = camPosRef_ + camDirRef_ * 2.0f;
@@ -76,11 +80,18 @@ void GuiPanel::addLight(int type) {
     selectedLight_ = (int)lights_.size() - 1;
 }
 
+// Adds small, dim point lights at random around the orbit center (for clustered shading tests).
+void GuiPanel::scatterLights(int count) {
+    scatterPointLights(lights_, count, orbitCenterRef_);
+}
+
 void GuiPanel::drawMaterialSection() {
     if (ImGui::CollapsingHeader("Material", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::ColorEdit3("Object Color", (float*)&objectColor_);
         ImGui::SliderFloat("Shininess", &shininess_, 1.0f, 256.0f);
         ImGui::Checkbox("Use Normal Map (N)", &useNormalMap_);
+        ImGui::SameLine();
+        ImGui::Checkbox("Flip green (D3D)", &flipNormalY_);
 
         ImGui::Separator();
         if (ImGui::CollapsingHeader("Model / Rotation", ImGuiTreeNodeFlags_DefaultOpen)) {
@@ -106,6 +117,13 @@ void GuiPanel::drawLightsSection() {
         ImGui::SameLine();
         if (ImGui::Button("+ Spot")) addLight((int)LightType::Spot);
 
+        ImGui::SliderInt("##scatter", &scatterCount_, 1, 10000);
+        ImGui::SameLine();
+        if (ImGui::Button("Scatter point lights")) scatterLights(scatterCount_);
+        ImGui::SameLine();
+        if (ImGui::Button("Remove all")) { lights_.clear(); selectedLight_ = 0; }
+        ImGui::Text("%zu lights", lights_.size());
+
         if (!lights_.empty()) {
             ImGui::Separator();
             ImGui::Text("Active light:");
@@ -132,7 +150,9 @@ void GuiPanel::drawLightsSection() {
             }
         }
 
-        for (int i = 0; i < (int)lights_.size(); ++i) {
+        int first = 0, last = (int)lights_.size();
+        if (last > MAX_LISTED_LIGHTS) { first = selectedLight_; last = std::min(selectedLight_ + 1, last); }
+        for (int i = first; i < last; ++i) {
             ImGui::Separator();
             ImGui::PushID(i);
 
@@ -1,7 +1,8 @@
 /*
  * Annotated for clarity:
  *  - This project implements Phong shading with optional normal mapping,
- *    supports up to 8 lights (directional/point/spot), and uses ImGui for GUI.
+ *    supports up to 8 lights (directional/point/spot) on the forward path and
+ *    thousands with clustered forward shading, and uses ImGui for GUI.
  */
 
 #pragma once
@@ -15,7 +16,7 @@
 class GuiPanel {
 public:
     GuiPanel(GLFWwindow* window,
-             glm::vec3& objectColor, float& shininess, bool& useNormalMap,
+             glm::vec3& objectColor, float& shininess, bool& useNormalMap, bool& flipNormalY,
              std::vector<LightCPU>& lights,
              glm::vec3& camPosRef, glm::vec3& camDirRef,
              bool& showLightGizmos,
@@ -38,12 +39,14 @@ private:
     void drawMaterialSection();
     void drawLightsSection();
     void addLight(int type);
+    void scatterLights(int count);
 
 private:
     GLFWwindow* window_;
     glm::vec3& objectColor_;
     float& shininess_;
     bool& useNormalMap_;
+    bool& flipNormalY_;
     std::vector<LightCPU>& lights_;
     glm::vec3& camPosRef_;
     glm::vec3& camDirRef_;
@@ -56,6 +59,7 @@ private:
     glm::vec3& orbitCenterRef_;
 
     int selectedLight_ = 0;
+    int scatterCount_ = 1000;
 };
 
 #endif // USE_IMGUI
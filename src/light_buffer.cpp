@@ -0,0 +1,52 @@
+#include "light_buffer.h"
+#include "shader.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+void LightBuffer::init() {
+    glGenBuffers(1, &ubo_);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, ubo_);
+}
+
+void LightBuffer::attach(const Shader& shader) const {
+    shader.bindUniformBlock("LightBlock", BINDING);
+}
+
+void LightBuffer::upload(const std::vector<LightCPU>& lights, float cutoff) {
+    int n = std::min((int)lights.size(), MAX_LIGHTS);
+    int prevN = uploadedValid_ ? uploaded_.count.x : 0;
+
+    // group by type, keeping the original order within each type
+    int perType[3] = { 0, 0, 0 };
+    for (int i = 0; i < n; ++i) ++perType[(int)lights[i].type];
+    int slot[3] = { 0, perType[0], perType[0] + perType[1] };
+    for (int i = 0; i < n; ++i) staging_.lights[slot[(int)lights[i].type]++] = packLight(lights[i], cutoff);
+    staging_.count = glm::ivec4(n, perType[0], perType[1], perType[2]);
+
+    // byte range [lo, hi) of the block that differs from the GPU copy
+    size_t lo = sizeof(Block), hi = 0;
+    if (!uploadedValid_ || staging_.count != uploaded_.count) { lo = 0; hi = sizeof(glm::ivec4); }
+    int dirty = 0;
+    for (int i = 0; i < n; ++i) {
+        if (i < prevN && std::memcmp(&staging_.lights[i], &uploaded_.lights[i], sizeof(LightGPU)) == 0) continue;
+        size_t off = offsetof(Block, lights) + i * sizeof(LightGPU);
+        lo = std::min(lo, off);
+        hi = std::max(hi, off + sizeof(LightGPU));
+        ++dirty;
+    }
+
+    lastDirty_ = dirty;
+    lastBytes_ = hi > lo ? hi - lo : 0;
+    if (!lastBytes_) return;
+
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(&staging_);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+    glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr)lo, (GLsizeiptr)lastBytes_, src + lo);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    std::memcpy(reinterpret_cast<unsigned char*>(&uploaded_) + lo, src + lo, lastBytes_);
+    uploadedValid_ = true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#ifndef LIGHT_BUFFER_H
+#define LIGHT_BUFFER_H
+
+#include <glad/glad.h>
+#include <vector>
+#include "lighting.h"
+
+class Shader;
+
+// Uniform buffer holding the packed light array (LightBlock in fragment.shader).
+// Lights are stored grouped by type (directional, point, spot) so the shader can loop
+// over each type with a compile-time count (see ShaderFeatures).
+// Keeps a copy of what the GPU already has and writes only the dirty sub-range,
+// with at most one glBufferSubData per upload.
+class LightBuffer {
+public:
+    static const GLuint BINDING = 0;
+
+    void init();
+    // Associates the shader's LightBlock with this buffer's binding point.
+    void attach(const Shader& shader) const;
+    // Packs the first MAX_LIGHTS lights and uploads the range that changed since the last call.
+    void upload(const std::vector<LightCPU>& lights, float cutoff = LIGHT_CUTOFF);
+
+    // Directional / point / spot counts of the last upload.
+    glm::ivec3 typeCounts() const { return glm::ivec3(staging_.count.y, staging_.count.z, staging_.count.w); }
+
+    // Stats of the most recent upload().
+    size_t lastUploadBytes() const { return lastBytes_; }
+    int    lastDirtyLights() const { return lastDirty_; }
+
+private:
+    struct Block {
+        glm::ivec4 count;  // x = total, y = directional, z = point, w = spot
+        LightGPU   lights[MAX_LIGHTS];
+    };
+
+    GLuint ubo_ = 0;
+    Block  staging_{};
+    Block  uploaded_{};        // shadow of the buffer contents
+    bool   uploadedValid_ = false;
+    size_t lastBytes_ = 0;
+    int    lastDirty_ = 0;
+};
+
+#endif
@@ -0,0 +1,146 @@
+#include "light_clusters.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+static void makeBufferTexture(GLuint& buf, GLuint& tex, GLenum format) {
+    glGenBuffers(1, &buf);
+    glBindBuffer(GL_TEXTURE_BUFFER, buf);
+    glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_BUFFER, tex);
+    glTexBuffer(GL_TEXTURE_BUFFER, format, buf);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+// Orphan and refill; buffers are rebuilt from scratch every frame.
+static void uploadBuffer(GLuint buf, const void* data, size_t bytes) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buf);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr)(bytes ? bytes : 16), nullptr, GL_STREAM_DRAW);
+    if (bytes) glBufferSubData(GL_TEXTURE_BUFFER, 0, (GLsizeiptr)bytes, data);
+}
+
+void LightClusters::init() {
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels_);
+    makeBufferTexture(lightBuf_, lightTex_, GL_RGBA32F);
+    makeBufferTexture(gridBuf_, gridTex_, GL_RG32UI);
+    makeBufferTexture(indexBuf_, indexTex_, GL_R32UI);
+    grid_.resize(CLUSTER_COUNT);
+    cursor_.resize(CLUSTER_COUNT);
+}
+
+void LightClusters::build(const std::vector<LightCPU>& lights, const glm::mat4& view,
+                          float fovYRad, float aspect, float zNear, float zFar, float cutoff) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    const float tanY = std::tan(fovYRad * 0.5f);
+    const float tanX = tanY * aspect;
+    const float logRatio = std::log(zFar / zNear);
+    zParams_ = glm::vec2(DIM_Z / logRatio, -DIM_Z * std::log(zNear) / logRatio);
+
+    auto tileOf = [](float ndc, int dim) { return glm::clamp((int)std::floor((ndc * 0.5f + 0.5f) * dim), 0, dim - 1); };
+
+    // the light buffer holds LIGHT_TEXELS RGBA32F texels per light, the index list one R32UI per entry
+    const int LIGHT_TEXELS = (int)(sizeof(LightGPU) / sizeof(glm::vec4));
+    int n = std::min({ (int)lights.size(), MAX_CLUSTERED_LIGHTS, (int)maxTexels_ / LIGHT_TEXELS });
+    int dropped = (int)lights.size() - n;
+    packed_.resize(n);
+    std::vector<Bounds> bounds;
+    std::vector<int> local;   // point/spot lights that reach the frustum
+    bounds.reserve(n);
+    local.reserve(n);
+
+    std::fill(grid_.begin(), grid_.end(), glm::uvec2(0));
+    dirCount_ = 0;
+    for (int i = 0; i < n; ++i) {
+        const LightCPU& L = lights[i];
+        packed_[i] = packLight(L, cutoff);
+        if (L.type == LightType::Directional) { ++dirCount_; continue; }
+
+        float r = packed_[i].attenuation.w; // lightRange(L)
+        if (r <= 0.0f) continue;
+        glm::vec3 c = glm::vec3(view * glm::vec4(L.position, 1.0f));
+        float d0 = std::max(-c.z - r, zNear), d1 = std::min(-c.z + r, zFar);
+        if (d0 > d1) continue; // entirely in front of the near or behind the far plane
+
+        Bounds b;
+        b.z0 = glm::clamp((int)std::floor(std::log(d0) * zParams_.x + zParams_.y), 0, DIM_Z - 1);
+        b.z1 = glm::clamp((int)std::floor(std::log(d1) * zParams_.x + zParams_.y), 0, DIM_Z - 1);
+        // x/y extent of the sphere's AABB projected at the nearest and farthest depth it spans;
+        // the projection is monotonic in depth so the extremes are at the endpoints
+        float xs[4] = { (c.x - r) / (d0 * tanX), (c.x - r) / (d1 * tanX), (c.x + r) / (d0 * tanX), (c.x + r) / (d1 * tanX) };
+        float ys[4] = { (c.y - r) / (d0 * tanY), (c.y - r) / (d1 * tanY), (c.y + r) / (d0 * tanY), (c.y + r) / (d1 * tanY) };
+        float xMin = std::min(std::min(xs[0], xs[1]), std::min(xs[2], xs[3]));
+        float xMax = std::max(std::max(xs[0], xs[1]), std::max(xs[2], xs[3]));
+        float yMin = std::min(std::min(ys[0], ys[1]), std::min(ys[2], ys[3]));
+        float yMax = std::max(std::max(ys[0], ys[1]), std::max(ys[2], ys[3]));
+        if (xMax < -1.0f || xMin > 1.0f || yMax < -1.0f || yMin > 1.0f) continue;
+        b.x0 = tileOf(xMin, DIM_X); b.x1 = tileOf(xMax, DIM_X);
+        b.y0 = tileOf(yMin, DIM_Y); b.y1 = tileOf(yMax, DIM_Y);
+        bounds.push_back(b);
+        local.push_back(i);
+    }
+
+    // lights whose clusters no longer fit in the index list (after the directional ones) are dropped
+    size_t entries = (size_t)dirCount_, kept = 0;
+    for (size_t k = 0; k < bounds.size(); ++k) {
+        const Bounds& b = bounds[k];
+        size_t cells = (size_t)(b.x1 - b.x0 + 1) * (b.y1 - b.y0 + 1) * (b.z1 - b.z0 + 1);
+        if (entries + cells > (size_t)maxTexels_) { ++dropped; continue; }
+        entries += cells;
+        bounds[kept] = b; local[kept] = local[k]; ++kept;
+    }
+    bounds.resize(kept); local.resize(kept);
+    if (dropped > 0 && dropped_ == 0)  // once when it starts; Diagnostics shows the live count
+        std::cout << "WARNING::LIGHT_CLUSTERS::TEXTURE_BUFFER_LIMIT: dropped " << dropped << " of " << lights.size()
+                  << " lights (GL_MAX_TEXTURE_BUFFER_SIZE " << maxTexels_ << ")" << std::endl;
+    dropped_ = dropped;
+
+    // pass 1: count per cluster
+    for (const Bounds& b : bounds)
+        for (int z = b.z0; z <= b.z1; ++z)
+            for (int y = b.y0; y <= b.y1; ++y)
+                for (int x = b.x0; x <= b.x1; ++x)
+                    ++grid_[(z * DIM_Y + y) * DIM_X + x].y;
+
+    // prefix sum into offsets, directional lights first
+    unsigned int offset = (unsigned int)dirCount_;
+    maxLights_ = 0; occupied_ = 0;
+    for (int c = 0; c < CLUSTER_COUNT; ++c) {
+        grid_[c].x = offset;
+        cursor_[c] = offset;
+        offset += grid_[c].y;
+        maxLights_ = std::max(maxLights_, (int)grid_[c].y);
+        if (grid_[c].y) ++occupied_;
+    }
+    indices_.resize(offset);
+
+    // pass 2: fill
+    unsigned int d = 0;
+    for (int i = 0; i < n; ++i)
+        if (lights[i].type == LightType::Directional) indices_[d++] = (unsigned int)i;
+    for (size_t k = 0; k < bounds.size(); ++k) {
+        const Bounds& b = bounds[k];
+        for (int z = b.z0; z <= b.z1; ++z)
+            for (int y = b.y0; y <= b.y1; ++y)
+                for (int x = b.x0; x <= b.x1; ++x)
+                    indices_[cursor_[(z * DIM_Y + y) * DIM_X + x]++] = (unsigned int)local[k];
+    }
+
+    uploadBuffer(lightBuf_, packed_.data(), packed_.size() * sizeof(LightGPU));
+    uploadBuffer(gridBuf_, grid_.data(), grid_.size() * sizeof(glm::uvec2));
+    uploadBuffer(indexBuf_, indices_.data(), indices_.size() * sizeof(unsigned int));
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    avgLights_ = (float)(offset - dirCount_) / (float)CLUSTER_COUNT;
+    buildMs_ = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+}
+
+void LightClusters::bind() const {
+    glActiveTexture(GL_TEXTURE0 + UNIT_LIGHTS);  glBindTexture(GL_TEXTURE_BUFFER, lightTex_);
+    glActiveTexture(GL_TEXTURE0 + UNIT_GRID);    glBindTexture(GL_TEXTURE_BUFFER, gridTex_);
+    glActiveTexture(GL_TEXTURE0 + UNIT_INDICES); glBindTexture(GL_TEXTURE_BUFFER, indexTex_);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "lighting.h"
+
+// Clustered forward shading: the view frustum is split into a 3D grid (screen tiles x
+// exponential depth slices) and each cluster keeps the list of point/spot lights whose
+// attenuation range touches it. Everything lives in texture buffers so it works on a
+// plain GL 3.3 context.
+//
+// Index list layout: [directional lights...][cluster 0 lights...][cluster 1 lights...]...
+class LightClusters {
+public:
+    static const int DIM_X = 16;
+    static const int DIM_Y = 9;
+    static const int DIM_Z = 24;
+    static const int CLUSTER_COUNT = DIM_X * DIM_Y * DIM_Z;
+
+    // Texture units used by bind(); the fragment shader samplers must match.
+    static const int UNIT_LIGHTS = 1;
+    static const int UNIT_GRID = 2;
+    static const int UNIT_INDICES = 3;
+
+    // Also reads GL_MAX_TEXTURE_BUFFER_SIZE (only 65536 texels guaranteed on GL 3.3).
+    void init();
+    // Assigns lights to clusters for the given camera and uploads lights, grid and index list.
+    // Light extents are lightRange(L, cutoff). Lights that would take the light buffer or the
+    // index list past the texture buffer limit are dropped (see droppedLights()).
+    void build(const std::vector<LightCPU>& lights, const glm::mat4& view,
+               float fovYRad, float aspect, float zNear, float zFar, float cutoff = LIGHT_CUTOFF);
+    void bind() const;
+
+    // slice = log(viewDepth) * zParams.x + zParams.y
+    glm::vec2 zParams() const { return zParams_; }
+    int directionalCount() const { return dirCount_; }
+
+    // Stats of the most recent build().
+    double buildMs() const { return buildMs_; }
+    float  avgLightsPerCluster() const { return avgLights_; }
+    int    maxLightsPerCluster() const { return maxLights_; }
+    int    occupiedClusters() const { return occupied_; }
+    int    droppedLights() const { return dropped_; }
+
+private:
+    struct Bounds { int x0, x1, y0, y1, z0, z1; };
+
+    GLuint lightBuf_ = 0, gridBuf_ = 0, indexBuf_ = 0;
+    GLuint lightTex_ = 0, gridTex_ = 0, indexTex_ = 0;
+
+    std::vector<LightGPU>     packed_;
+    std::vector<glm::uvec2>   grid_;      // (offset, count) per cluster
+    std::vector<unsigned int> indices_;
+    std::vector<unsigned int> cursor_;
+
+    GLint  maxTexels_ = 65536;  // GL_MAX_TEXTURE_BUFFER_SIZE
+    glm::vec2 zParams_{ 0.0f };
+    int    dirCount_ = 0;
+    double buildMs_ = 0.0;
+    float  avgLights_ = 0.0f;
+    int    maxLights_ = 0;
+    int    occupied_ = 0;
+    int    dropped_ = 0;
+};
+
+#endif
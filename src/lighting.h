@@ -1,5 +1,17 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Forward path (LightBlock UBO) limit; must match MAX_LIGHTS in shaders/fragment.shader.
+constexpr int MAX_LIGHTS = 8;
+// Clustered path limit (lights live in a texture buffer; a small GL_MAX_TEXTURE_BUFFER_SIZE
+// lowers it further, see LightClusters).
+constexpr int MAX_CLUSTERED_LIGHTS = 16384;
+// Default attenuated intensity below which a light is treated as having no effect.
+constexpr float LIGHT_CUTOFF = 1.0f / 256.0f;
 
 enum class LightType : int { Directional = 0, Point = 1, Spot = 2 };
 
@@ -24,3 +36,85 @@ struct LightCPU {
     bool drawGizmo = true;
     bool followCamera = false; // for the spotlight, if you need to "stick" to the camera
 };
+
+// Distance at which the light's attenuated contribution falls below cutoff.
+// Directional lights and lights without distance falloff are unbounded.
+inline float lightRange(const LightCPU& L, float cutoff = LIGHT_CUTOFF) {
+    if (L.type == LightType::Directional) return INFINITY;
+    float peak = std::max(L.color.r, std::max(L.color.g, L.color.b)) * (L.ambient + L.diffuse + L.specular);
+    float k = peak / cutoff;                 // need constant + linear*d + quadratic*d^2 >= k
+    if (L.constant >= k) return 0.0f;        // never bright enough to matter
+    float c = L.constant - k;
+    if (L.quadratic > 0.0f) return (-L.linear + std::sqrt(L.linear * L.linear - 4.0f * L.quadratic * c)) / (2.0f * L.quadratic);
+    if (L.linear > 0.0f) return -c / L.linear;
+    return INFINITY;
+}
+
+// std140 mirror of LightCPU, as laid out in the LightBlock uniform block.
+// Every field is a vec4 so the C++ and GLSL layouts match without padding rules.
+struct LightGPU {
+    glm::vec4 positionType;    // xyz = position, w = type
+    glm::vec4 directionInner;  // xyz = normalized direction, w = cos(inner)
+    glm::vec4 colorOuter;      // rgb = color, w = cos(outer)
+    glm::vec4 attenuation;     // x = constant, y = linear, z = quadratic, w = lightRange()
+    glm::vec4 intensity;       // x = ambient, y = diffuse, z = specular
+};
+static_assert(sizeof(LightGPU) == 5 * sizeof(glm::vec4), "LightGPU must stay std140-compatible");
+
+// True if the light can reach any point of the sphere: point lights by range, spot lights
+// by range and, when they have no ambient term, by their outer cone. The shaders add a spot
+// light's ambient outside the cone too (only diffuse and specular are masked, see phong()).
+inline bool lightReachesSphere(const LightCPU& L, const glm::vec3& center, float radius, float cutoff = LIGHT_CUTOFF) {
+    if (L.type == LightType::Directional) return true;
+    float range = lightRange(L, cutoff);
+    glm::vec3 toCenter = center - L.position;
+    float distSq = glm::dot(toCenter, toCenter);
+    if (distSq > (range + radius) * (range + radius)) return false;
+    if (L.type != LightType::Spot || L.ambient > 0.0f) return true;
+    if (L.outerCutoff <= 0.0f) return true;  // cones of 90+ degrees: sphere test only
+
+    // cone vs sphere: distance from the center to the cone surface, measured perpendicular to it
+    glm::vec3 axis = glm::normalize(L.direction);
+    float along = glm::dot(toCenter, axis);
+    float cosA = L.outerCutoff, sinA = std::sqrt(std::max(0.0f, 1.0f - cosA * cosA));
+    float across = std::sqrt(std::max(0.0f, distSq - along * along));
+    if (cosA * across - sinA * along > radius) return false;  // outside the cone's side
+    return along >= -radius;                                   // not entirely behind the apex
+}
+
+// Lights that can affect an object bounded by (center, radius), in their original order.
+inline void cullLights(const std::vector<LightCPU>& lights, const glm::vec3& center, float radius,
+                       float cutoff, std::vector<LightCPU>& out) {
+    out.clear();
+    for (const auto& L : lights)
+        if (lightReachesSphere(L, center, radius, cutoff)) out.push_back(L);
+}
+
+// Appends up to `count` small, dim point lights (about 2 units of range) at random within
+// 5 units of `center`, keeping the set under MAX_CLUSTERED_LIGHTS. Seeded by the current
+// light count, so the same sequence of calls gives the same lights.
+inline void scatterPointLights(std::vector<LightCPU>& lights, int count, const glm::vec3& center) {
+    std::mt19937 rng(1234u + (unsigned)lights.size());
+    std::uniform_real_distribution<float> pos(-5.0f, 5.0f), hue(0.2f, 1.0f);
+    count = std::min(count, MAX_CLUSTERED_LIGHTS - (int)lights.size());
+    for (int i = 0; i < count; ++i) {
+        LightCPU L{};
+        L.type = LightType::Point;
+        L.position = center + glm::vec3(pos(rng), pos(rng), pos(rng));
+        L.constant = 1.0f; L.linear = 0.0f; L.quadratic = 30.0f; // ~2 unit range at LIGHT_CUTOFF
+        L.color = { hue(rng), hue(rng), hue(rng) };
+        L.ambient = 0.0f; L.diffuse = 0.35f; L.specular = 0.15f;
+        L.drawGizmo = false;
+        lights.push_back(L);
+    }
+}
+
+inline LightGPU packLight(const LightCPU& L, float cutoff = LIGHT_CUTOFF) {
+    LightGPU g;
+    g.positionType = glm::vec4(L.position, (float)L.type);
+    g.directionInner = glm::vec4(glm::normalize(L.direction), L.innerCutoff);
+    g.colorOuter = glm::vec4(L.color, L.outerCutoff);
+    g.attenuation = glm::vec4(L.constant, L.linear, L.quadratic, lightRange(L, cutoff));
+    g.intensity = glm::vec4(L.ambient, L.diffuse, L.specular, 0.0f);
+    return g;
+}
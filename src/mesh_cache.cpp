@@ -0,0 +1,34 @@
+#include "mesh_cache.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<CookedMeshHeader>::value, "CookedMeshHeader is written as raw bytes");
+static_assert(std::is_trivially_copyable<Submesh>::value, "Submesh is written as raw bytes");
+
+std::string meshCacheFile(std::uint64_t sourceHash, std::uint64_t settingsHash){
+    char name[64];
+    std::snprintf(name,sizeof(name),"%016llx-%016llx.mesh",(unsigned long long)sourceHash,(unsigned long long)settingsHash);
+    return std::string(MESH_CACHE_DIR)+"/"+name;
+}
+
+bool writeCookedMesh(const std::string& file, const CookedMeshHeader& header, const Submesh* submeshes,
+                     const void* buffer, size_t bufferBytes){
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(file).parent_path(),ec);
+    std::string tmp=file+".tmp";
+    {
+        std::ofstream out(tmp,std::ios::binary|std::ios::trunc);
+        out.write((const char*)&header,sizeof(header));
+        out.write((const char*)submeshes,(std::streamsize)(header.submeshCount*sizeof(Submesh)));
+        static const char zeros[16]={};
+        out.write(zeros,(std::streamsize)(header.bufferOffset-header.submeshOffset-header.submeshCount*sizeof(Submesh)));
+        out.write((const char*)buffer,(std::streamsize)bufferBytes);
+        if(!out){ std::cout<<"ERROR::MESH_CACHE::WRITE_FAILED: "<<tmp<<std::endl; return false; }
+    }
+    std::filesystem::rename(tmp,file,ec);
+    if(ec){ std::cout<<"ERROR::MESH_CACHE::WRITE_FAILED: "<<file<<" ("<<ec.message()<<")"<<std::endl; std::filesystem::remove(tmp,ec); return false; }
+    return true;
+}
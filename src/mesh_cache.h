@@ -0,0 +1,41 @@
+#pragma once
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include "model.h"
+
+// Cooked models, stored under MESH_CACHE_DIR as <key>.mesh so a repeat load skips Assimp and
+// every import pass. Layout: CookedMeshHeader, the Submesh table, then the GPU buffer exactly
+// as Model uploads it (indices padded to 4 bytes, then PackedVertex data).
+static const char* const MESH_CACHE_DIR = "cache/meshes";
+static const std::uint32_t MESH_CACHE_VERSION = 2;  // 2: LOD errors summed along the chain
+
+struct CookedMeshHeader {
+    char          magic[8];          // "8PMESH"
+    std::uint32_t version;
+    std::uint32_t headerBytes;       // sizeof(CookedMeshHeader), catches layout changes between builds
+    std::uint64_t sourceHash, settingsHash;
+    std::uint32_t vertexCount, indexCount, indexSize, submeshCount;
+    std::int32_t  lodCount;
+    float         lodErrors[Submesh::MAX_LODS];
+    glm::vec3     posScale, posOffset;
+    glm::vec3     boundsMin, boundsMax, boundsCenter;
+    float         boundsRadius;
+    MeshStats     importStats, optimizedStats;
+    std::uint64_t importedVertices;
+    double        weldMs, optimizeMs;
+    std::uint64_t submeshOffset, bufferOffset, bufferBytes, vertexOffset;
+};
+
+// Cache file for a source content hash and import settings hash.
+std::string meshCacheFile(std::uint64_t sourceHash, std::uint64_t settingsHash);
+
+// Writes header, submesh table and buffer to a temporary file, then renames it into place so
+// a crash never leaves a truncated cache entry. Returns false (and logs) on failure.
+bool writeCookedMesh(const std::string& file, const CookedMeshHeader& header, const Submesh* submeshes,
+                     const void* buffer, size_t bufferBytes);
+
+#endif
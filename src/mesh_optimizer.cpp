@@ -0,0 +1,414 @@
+#include "mesh_optimizer.h"
+#include "model.h"
+#include "parallel.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+// FIFO post-transform cache, using timestamps: a vertex is resident while fewer than
+// CACHE_SIZE misses happened since it was loaded.
+struct FifoCache {
+    std::vector<unsigned> stamp;
+    unsigned time;
+    explicit FifoCache(size_t vertexCount):stamp(vertexCount,0),time(MeshStats::CACHE_SIZE+1) {}
+    bool miss(unsigned v){
+        if(time-stamp[v]<=MeshStats::CACHE_SIZE) return false;
+        stamp[v]=time++; return true;
+    }
+    void reset(){ time+=MeshStats::CACHE_SIZE+1; }
+    unsigned missesOf(const unsigned* tri){ return miss(tri[0])+miss(tri[1])+miss(tri[2]); }
+};
+
+// Depth-tested rasterization of the mesh into a small grid; counts fragments that pass
+// (as early-z would shade them) and pixels covered at the end.
+static const int OVERDRAW_GRID=256;
+
+static void rasterizeView(const Vertex* vertices, const unsigned* indices, size_t indexCount,
+                          const glm::vec3& bmin, const glm::vec3& extent, int axis, bool positive,
+                          std::vector<float>& depth, MeshStats& stats){
+    const int b=(axis+1)%3, c=(axis+2)%3;  // (b, c, axis) stays right-handed, so CCW is front-facing
+    std::fill(depth.begin(),depth.end(),1e30f);
+    auto project=[&](const glm::vec3& p){
+        glm::vec3 n=(p-bmin)/extent;  // 0..1
+        float x=positive ? n[b] : 1.0f-n[b];
+        return glm::vec3(x*OVERDRAW_GRID,n[c]*OVERDRAW_GRID,positive ? -n[axis] : n[axis]);
+    };
+    for(size_t i=0;i+2<indexCount;i+=3){
+        glm::vec3 p0=project(vertices[indices[i]].Position);
+        glm::vec3 p1=project(vertices[indices[i+1]].Position);
+        glm::vec3 p2=project(vertices[indices[i+2]].Position);
+        float area=(p1.x-p0.x)*(p2.y-p0.y)-(p1.y-p0.y)*(p2.x-p0.x);
+        if(area<=0.0f) continue;  // back-facing or degenerate
+        int x0=std::max(0,(int)std::floor(std::min({p0.x,p1.x,p2.x})));
+        int x1=std::min(OVERDRAW_GRID-1,(int)std::ceil(std::max({p0.x,p1.x,p2.x})));
+        int y0=std::max(0,(int)std::floor(std::min({p0.y,p1.y,p2.y})));
+        int y1=std::min(OVERDRAW_GRID-1,(int)std::ceil(std::max({p0.y,p1.y,p2.y})));
+        for(int y=y0;y<=y1;y++) for(int x=x0;x<=x1;x++){
+            float px=x+0.5f, py=y+0.5f;
+            float w0=(p2.x-p1.x)*(py-p1.y)-(p2.y-p1.y)*(px-p1.x);
+            float w1=(p0.x-p2.x)*(py-p2.y)-(p0.y-p2.y)*(px-p2.x);
+            float w2=(p1.x-p0.x)*(py-p0.y)-(p1.y-p0.y)*(px-p0.x);
+            if(w0<0.0f || w1<0.0f || w2<0.0f) continue;
+            float z=(w0*p0.z+w1*p1.z+w2*p2.z)/area;
+            float& d=depth[y*OVERDRAW_GRID+x];
+            if(z<d){ d=z; stats.pixelsShaded++; }
+        }
+    }
+    for(float d: depth) if(d<1e30f) stats.pixelsCovered++;
+}
+
+MeshStats analyzeMesh(const Vertex* vertices, size_t vertexCount, const unsigned* indices, size_t indexCount){
+    MeshStats stats;
+    stats.triangles=indexCount/3;
+    if(!vertexCount || !indexCount) return stats;
+    FifoCache cache(vertexCount);
+    std::vector<char> used(vertexCount,0);
+    glm::vec3 bmin(1e30f), bmax(-1e30f);
+    for(size_t i=0;i<indexCount;i++){
+        unsigned v=indices[i];
+        if(cache.miss(v)) stats.cacheMisses++;
+        if(!used[v]){ used[v]=1; stats.vertices++; bmin=glm::min(bmin,vertices[v].Position); bmax=glm::max(bmax,vertices[v].Position); }
+    }
+    glm::vec3 extent=glm::max(bmax-bmin,glm::vec3(1e-8f));
+    std::vector<float> depth(OVERDRAW_GRID*OVERDRAW_GRID);
+    for(int axis=0;axis<3;axis++){
+        rasterizeView(vertices,indices,indexCount,bmin,extent,axis,true,depth,stats);
+        rasterizeView(vertices,indices,indexCount,bmin,extent,axis,false,depth,stats);
+    }
+    return stats;
+}
+
+// Every Vertex float, rounded to a multiple of epsilon (inv = 1/epsilon) or as raw bits.
+using WeldKey=std::array<std::uint64_t,14>;
+static const size_t WELD_MIN_PER_THREAD=16384;
+
+static void weldKey(const Vertex& v, double inv, WeldKey& key){
+    const float* f[5]={&v.Position.x,&v.Normal.x,&v.TexCoords.x,&v.Tangent.x,&v.Bitangent.x};
+    const int n[5]={3,3,2,3,3};
+    size_t k=0;
+    for(int a=0;a<5;a++) for(int c=0;c<n[a];c++){
+        float x=f[a][c];
+        if(inv>0.0) key[k++]=(std::uint64_t)std::llround(x*inv);
+        else { if(x==0.0f) x=0.0f; std::uint32_t bits; std::memcpy(&bits,&x,4); key[k++]=bits; }  // -0 == +0
+    }
+}
+
+static std::uint64_t hashKey(const WeldKey& key){
+    std::uint64_t h=1469598103934665603ull;  // FNV-1a over words, then a murmur finalizer
+    for(std::uint64_t w: key){ h^=w; h*=1099511628211ull; }
+    h^=h>>33; h*=0xff51afd7ed558ccdull; h^=h>>33;
+    return h;
+}
+
+size_t weldVertices(Vertex* vertices, size_t vertexCount, unsigned* indices, size_t indexCount, float epsilon, unsigned threads){
+    if(vertexCount<2) return vertexCount;
+    if(!threads) threads=std::max(1u,std::thread::hardware_concurrency());
+    threads=(unsigned)std::min<size_t>(threads,std::max<size_t>(1,vertexCount/WELD_MIN_PER_THREAD));
+    const double inv=epsilon>0.0f ? 1.0/epsilon : 0.0;
+
+    std::vector<std::uint64_t> hash(vertexCount);
+    parallelFor(threads,[&](unsigned t){
+        WeldKey key;
+        for(size_t v=vertexCount*t/threads;v<vertexCount*(t+1)/threads;v++){ weldKey(vertices[v],inv,key); hash[v]=hashKey(key); }
+    });
+    // partition by the high bits, probe by the low ones; visiting in index order makes the
+    // first occurrence of each key its representative
+    std::vector<unsigned> first(vertexCount);
+    parallelFor(threads,[&](unsigned t){
+        auto owns=[&](size_t v){ return (unsigned)((hash[v]>>32)%threads)==t; };
+        size_t count=0;
+        for(size_t v=0;v<vertexCount;v++) count+=owns(v);
+        size_t cap=16;
+        while(cap<count*2) cap*=2;
+        std::vector<unsigned> table(cap,~0u);
+        WeldKey a, b;
+        for(size_t v=0;v<vertexCount;v++){
+            if(!owns(v)) continue;
+            for(size_t slot=hash[v]&(cap-1);;slot=(slot+1)&(cap-1)){
+                unsigned e=table[slot];
+                if(e==~0u){ table[slot]=(unsigned)v; first[v]=(unsigned)v; break; }
+                if(hash[e]!=hash[v]) continue;
+                weldKey(vertices[e],inv,a); weldKey(vertices[v],inv,b);
+                if(a==b){ first[v]=e; break; }
+            }
+        }
+    });
+
+    std::vector<unsigned> remap(vertexCount);
+    size_t count=0;
+    for(size_t v=0;v<vertexCount;v++){
+        if(first[v]==v){ if(count!=v) vertices[count]=vertices[v]; remap[v]=(unsigned)count++; }
+        else remap[v]=remap[first[v]];
+    }
+    parallelFor(threads,[&](unsigned t){
+        for(size_t i=indexCount*t/threads;i<indexCount*(t+1)/threads;i++) indices[i]=remap[indices[i]];
+    });
+    return count;
+}
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation": vertices score by LRU position and by
+// how few triangles still use them; the best-scoring triangle touching the cache goes next.
+static const int FORSYTH_CACHE=32;
+
+static float vertexScore(int cachePos, unsigned remaining){
+    if(!remaining) return -1.0f;
+    float score=0.0f;
+    if(cachePos>=0) score=cachePos<3 ? 0.75f : std::pow(1.0f-(cachePos-3)*(1.0f/(FORSYTH_CACHE-3)),1.5f);
+    return score+2.0f/std::sqrt((float)remaining);
+}
+
+void optimizeVertexCache(unsigned* indices, size_t indexCount, size_t vertexCount){
+    const size_t triCount=indexCount/3;
+    if(!triCount) return;
+    // triangles of each vertex; the first `remaining[v]` entries are the unemitted ones
+    std::vector<unsigned> remaining(vertexCount,0), offsets(vertexCount+1,0), adjacency(triCount*3);
+    for(size_t i=0;i<triCount*3;i++) remaining[indices[i]]++;
+    for(size_t v=0;v<vertexCount;v++) offsets[v+1]=offsets[v]+remaining[v];
+    {
+        std::vector<unsigned> fill(offsets.begin(),offsets.end()-1);
+        for(size_t i=0;i<triCount*3;i++) adjacency[fill[indices[i]]++]=(unsigned)(i/3);
+    }
+    std::vector<int> cachePos(vertexCount,-1);
+    std::vector<float> vScore(vertexCount);
+    std::vector<char> emitted(triCount,0);
+    for(size_t v=0;v<vertexCount;v++) vScore[v]=vertexScore(-1,remaining[v]);
+
+    std::vector<unsigned> out; out.reserve(triCount*3);
+    std::vector<unsigned> cache, next;
+    size_t scan=0;  // fallback when nothing in the cache has triangles left: next unemitted in input order
+    long best=-1;
+    while(out.size()<triCount*3){
+        if(best<0){ while(emitted[scan]) scan++; best=(long)scan; }
+        const unsigned* tri=&indices[best*3];
+        emitted[best]=1;
+        next.assign(tri,tri+3);
+        for(int k=0;k<3;k++){
+            unsigned v=tri[k];
+            out.push_back(v);
+            unsigned* adj=&adjacency[offsets[v]];
+            for(unsigned a=0;a<remaining[v];a++)
+                if(adj[a]==(unsigned)best){ std::swap(adj[a],adj[remaining[v]-1]); remaining[v]--; break; }
+        }
+        for(unsigned v: cache) if(v!=tri[0] && v!=tri[1] && v!=tri[2]) next.push_back(v);
+        // evicted vertices lose their cache bonus; their triangles are rescored below
+        for(size_t i=FORSYTH_CACHE;i<next.size();i++){ cachePos[next[i]]=-1; vScore[next[i]]=vertexScore(-1,remaining[next[i]]); }
+        for(size_t i=0;i<next.size();i++){
+            unsigned v=next[i];
+            if(i<(size_t)FORSYTH_CACHE){ cachePos[v]=(int)i; vScore[v]=vertexScore((int)i,remaining[v]); }
+        }
+        best=-1; float bestScore=-1e30f;
+        for(unsigned v: next){
+            for(unsigned a=0;a<remaining[v];a++){
+                unsigned t=adjacency[offsets[v]+a];
+                float s=vScore[indices[t*3]]+vScore[indices[t*3+1]]+vScore[indices[t*3+2]];
+                if(cachePos[v]>=0 && s>bestScore){ bestScore=s; best=(long)t; }
+            }
+        }
+        if(next.size()>(size_t)FORSYTH_CACHE) next.resize(FORSYTH_CACHE);
+        cache.swap(next);
+    }
+    std::copy(out.begin(),out.end(),indices);
+}
+
+void optimizeOverdraw(unsigned* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold){
+    const size_t triCount=indexCount/3;
+    if(triCount<2) return;
+    // hard boundaries where a triangle misses on all three vertices (the cache restarted)
+    std::vector<size_t> hard;
+    FifoCache cache(vertexCount);
+    for(size_t t=0;t<triCount;t++)
+        if(cache.missesOf(&indices[t*3])==3) hard.push_back(t);
+    if(hard.empty() || hard[0]!=0) hard.insert(hard.begin(),0);
+    hard.push_back(triCount);
+    // soft boundaries inside each one: a cluster ends once its own ACMR, simulated from an
+    // empty cache as if drawn after any other cluster, is within threshold of the whole range's
+    std::vector<size_t> clusters;
+    for(size_t h=0;h+1<hard.size();h++){
+        size_t begin=hard[h], end=hard[h+1], total=0;
+        cache.reset();
+        for(size_t t=begin;t<end;t++) total+=cache.missesOf(&indices[t*3]);
+        float rangeAcmr=(float)total/(end-begin);
+        clusters.push_back(begin);
+        size_t start=begin, run=0;
+        cache.reset();
+        for(size_t t=begin;t<end;t++){
+            run+=cache.missesOf(&indices[t*3]);
+            if(t+1<end && (float)run/(t+1-start)<=threshold*rangeAcmr){ clusters.push_back(t+1); start=t+1; run=0; cache.reset(); }
+        }
+    }
+    clusters.push_back(triCount);
+
+    // key = how far the cluster's triangles face away from the mesh center (area-weighted, per
+    // triangle so curved clusters don't cancel out); outward clusters draw first and occlude
+    auto corner=[&](size_t t,int k)->const glm::vec3& { return vertices[indices[t*3+k]].Position; };
+    glm::vec3 meshCentroid(0.0f); float meshArea=0.0f;
+    for(size_t t=0;t<triCount;t++){
+        float w=glm::length(glm::cross(corner(t,1)-corner(t,0),corner(t,2)-corner(t,0)));
+        meshCentroid+=(corner(t,0)+corner(t,1)+corner(t,2))*(w/3.0f); meshArea+=w;
+    }
+    if(meshArea>0.0f) meshCentroid/=meshArea;
+    std::vector<float> key(clusters.size()-1);
+    for(size_t c=0;c<key.size();c++){
+        float facing=0.0f, area=0.0f;
+        for(size_t t=clusters[c];t<clusters[c+1];t++){
+            glm::vec3 cr=glm::cross(corner(t,1)-corner(t,0),corner(t,2)-corner(t,0));
+            facing+=glm::dot((corner(t,0)+corner(t,1)+corner(t,2))/3.0f-meshCentroid,cr); area+=glm::length(cr);
+        }
+        key[c]=area>0.0f ? facing/area : 0.0f;
+    }
+    std::vector<size_t> order(key.size());
+    std::iota(order.begin(),order.end(),0);
+    std::stable_sort(order.begin(),order.end(),[&](size_t a,size_t b){ return key[a]>key[b]; });
+
+    std::vector<unsigned> out; out.reserve(triCount*3);
+    for(size_t c: order) out.insert(out.end(),indices+clusters[c]*3,indices+clusters[c+1]*3);
+    std::copy(out.begin(),out.end(),indices);
+}
+
+// Symmetric 4x4 plane quadric with the total weight of its planes, so the error of a point is
+// the area-weighted mean squared distance to them.
+struct Quadric {
+    double a=0,b=0,c=0,d=0, e=0,f=0,g=0, h=0,i=0, j=0, w=0;
+    void addPlane(const glm::dvec3& n, double dist, double weight){
+        a+=weight*n.x*n.x; b+=weight*n.x*n.y; c+=weight*n.x*n.z; d+=weight*n.x*dist;
+        e+=weight*n.y*n.y; f+=weight*n.y*n.z; g+=weight*n.y*dist;
+        h+=weight*n.z*n.z; i+=weight*n.z*dist; j+=weight*dist*dist; w+=weight;
+    }
+    Quadric& operator+=(const Quadric& q){
+        a+=q.a; b+=q.b; c+=q.c; d+=q.d; e+=q.e; f+=q.f; g+=q.g; h+=q.h; i+=q.i; j+=q.j; w+=q.w; return *this;
+    }
+    double error(const glm::vec3& p) const {
+        double x=p.x, y=p.y, z=p.z;
+        double q=a*x*x+2*b*x*y+2*c*x*z+2*d*x + e*y*y+2*f*y*z+2*g*y + h*z*z+2*i*z + j;
+        return w>0.0 ? std::max(q,0.0)/w : 0.0;
+    }
+};
+
+struct Collapse { double cost; unsigned from, to; };
+
+static glm::vec3 triNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c){ return glm::cross(b-a,c-a); }
+
+size_t simplifyMesh(unsigned* out, const unsigned* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                    size_t targetIndexCount, float maxError, float* error){
+    std::copy(indices,indices+indexCount,out);
+    size_t count=indexCount/3*3;
+    float worst=0.0f;
+    auto pos=[&](unsigned v)->const glm::vec3& { return vertices[v].Position; };
+    auto edgeKey=[](unsigned a, unsigned b){ return a<b ? (std::uint64_t)a<<32|b : (std::uint64_t)b<<32|a; };
+
+    // lock vertices of edges not shared by exactly two triangles
+    std::vector<std::uint64_t> edges;
+    edges.reserve(count);
+    for(size_t t=0;t<count;t+=3) for(int k=0;k<3;k++) edges.push_back(edgeKey(out[t+k],out[t+(k+1)%3]));
+    std::sort(edges.begin(),edges.end());
+    std::vector<char> locked(vertexCount,0);
+    for(size_t e=0;e<edges.size();){
+        size_t n=1;
+        while(e+n<edges.size() && edges[e+n]==edges[e]) n++;
+        if(n!=2){ locked[edges[e]>>32]=1; locked[edges[e]&0xffffffffu]=1; }
+        e+=n;
+    }
+
+    std::vector<Quadric> quadric(vertexCount);
+    for(size_t t=0;t<count;t+=3){
+        glm::dvec3 n=glm::dvec3(triNormal(pos(out[t]),pos(out[t+1]),pos(out[t+2])));
+        double area=glm::length(n);
+        if(area<=0.0) continue;
+        n/=area;
+        double dist=-glm::dot(n,glm::dvec3(pos(out[t])));
+        for(int k=0;k<3;k++) quadric[out[t+k]].addPlane(n,dist,area*0.5);
+    }
+
+    std::vector<Collapse> candidates;
+    std::vector<unsigned> remap(vertexCount), adjOffset(vertexCount+1), adjacency;
+    std::vector<char> touched(vertexCount);
+    const double maxCost=(double)maxError*maxError;
+    while(count>targetIndexCount){
+        // every collapse removes about two triangles; do at most what the target still needs
+        size_t collapsesLeft=std::max<size_t>((count-targetIndexCount)/6,1);
+
+        edges.clear();
+        for(size_t t=0;t<count;t+=3) for(int k=0;k<3;k++) edges.push_back(edgeKey(out[t+k],out[t+(k+1)%3]));
+        std::sort(edges.begin(),edges.end());
+        edges.erase(std::unique(edges.begin(),edges.end()),edges.end());
+        candidates.clear();
+        for(std::uint64_t e: edges){
+            unsigned a=(unsigned)(e>>32), b=(unsigned)(e&0xffffffffu);
+            if(locked[a] && locked[b]) continue;
+            Quadric q=quadric[a]; q+=quadric[b];
+            double ab=locked[a] ? 1e300 : q.error(pos(b));  // a onto b
+            double ba=locked[b] ? 1e300 : q.error(pos(a));
+            if(ab<=ba) candidates.push_back({ab,a,b}); else candidates.push_back({ba,b,a});
+        }
+        std::sort(candidates.begin(),candidates.end(),[](const Collapse& x, const Collapse& y){ return x.cost<y.cost; });
+
+        // triangles around each vertex, for the flip test
+        std::fill(adjOffset.begin(),adjOffset.end(),0);
+        for(size_t i=0;i<count;i++) adjOffset[out[i]+1]++;
+        for(size_t v=0;v<vertexCount;v++) adjOffset[v+1]+=adjOffset[v];
+        adjacency.resize(count);
+        {
+            std::vector<unsigned> fill(adjOffset.begin(),adjOffset.end()-1);
+            for(size_t i=0;i<count;i++) adjacency[fill[out[i]]++]=(unsigned)(i/3);
+        }
+
+        std::iota(remap.begin(),remap.end(),0u);
+        std::fill(touched.begin(),touched.end(),0);
+        size_t collapses=0;
+        for(const Collapse& c: candidates){
+            if(c.cost>maxCost || collapses>=collapsesLeft) break;
+            if(touched[c.from] || touched[c.to]) continue;
+            // reject collapses that flip (or flatten) any triangle that survives them
+            bool flips=false;
+            for(unsigned a=adjOffset[c.from];a<adjOffset[c.from+1] && !flips;a++){
+                const unsigned* tri=&out[adjacency[a]*3];
+                if(tri[0]==c.to || tri[1]==c.to || tri[2]==c.to) continue;
+                glm::vec3 p[3]={pos(tri[0]),pos(tri[1]),pos(tri[2])};
+                glm::vec3 before=triNormal(p[0],p[1],p[2]);
+                for(int k=0;k<3;k++) if(tri[k]==c.from) p[k]=pos(c.to);
+                glm::vec3 after=triNormal(p[0],p[1],p[2]);
+                flips=glm::dot(before,after)<=0.25f*glm::length(before)*glm::length(after);
+            }
+            if(flips) continue;
+            // one collapse per neighbourhood per pass, so the flip test above stays valid
+            for(unsigned a=adjOffset[c.from];a<adjOffset[c.from+1];a++)
+                for(int k=0;k<3;k++) touched[out[adjacency[a]*3+k]]=1;
+            touched[c.to]=1;
+            remap[c.from]=c.to;
+            quadric[c.to]+=quadric[c.from];
+            worst=std::max(worst,(float)std::sqrt(c.cost));
+            collapses++;
+        }
+        if(!collapses) break;
+
+        size_t kept=0;
+        for(size_t t=0;t<count;t+=3){
+            unsigned a=remap[out[t]], b=remap[out[t+1]], d=remap[out[t+2]];
+            if(a==b || b==d || a==d) continue;
+            out[kept++]=a; out[kept++]=b; out[kept++]=d;
+        }
+        count=kept;
+    }
+    if(error) *error=worst;
+    return count;
+}
+
+size_t optimizeVertexFetch(Vertex* vertices, size_t vertexCount, unsigned* indices, size_t indexCount){
+    std::vector<unsigned> remap(vertexCount,~0u);
+    unsigned next=0;
+    for(size_t i=0;i<indexCount;i++){
+        unsigned& r=remap[indices[i]];
+        if(r==~0u) r=next++;
+        indices[i]=r;
+    }
+    size_t referenced=next;
+    for(auto& r: remap) if(r==~0u) r=next++;
+    std::vector<Vertex> copy(vertices,vertices+vertexCount);
+    for(size_t v=0;v<vertexCount;v++) vertices[remap[v]]=copy[v];
+    return referenced;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+
+struct Vertex;
+
+// Import-time processing of one indexed triangle list (indices local to `vertices`).
+// Run in this order: weld, vertex cache, then overdraw (it keeps the cache order inside
+// each cluster), then vertex fetch (it renumbers vertices and so must come last).
+
+// Raw counters so stats of several submeshes can be summed before taking ratios.
+struct MeshStats {
+    size_t triangles=0, vertices=0;        // vertices = referenced vertices
+    size_t cacheMisses=0;                  // simulated FIFO post-transform cache (CACHE_SIZE entries)
+    size_t pixelsShaded=0, pixelsCovered=0;
+    static const unsigned CACHE_SIZE=16;
+    float acmr() const { return triangles ? (float)cacheMisses/triangles : 0.0f; }    // misses per triangle, 0.5..3
+    float atvr() const { return vertices ? (float)cacheMisses/vertices : 0.0f; }      // misses per vertex, 1 = ideal
+    float overdraw() const { return pixelsCovered ? (float)pixelsShaded/pixelsCovered : 0.0f; }
+    MeshStats& operator+=(const MeshStats& o){
+        triangles+=o.triangles; vertices+=o.vertices; cacheMisses+=o.cacheMisses;
+        pixelsShaded+=o.pixelsShaded; pixelsCovered+=o.pixelsCovered; return *this;
+    }
+};
+
+// Cache stats, plus overdraw from a depth-tested software rasterization from the six axis
+// directions with back faces culled, submitted in index order.
+MeshStats analyzeMesh(const Vertex* vertices, size_t vertexCount, const unsigned* indices, size_t indexCount);
+
+// Merges vertices whose attributes all round to the same multiple of `epsilon` (bitwise
+// equal when 0), keeping the first occurrence. Hashing and lookup run on up to `threads`
+// threads (0 = hardware concurrency); each thread owns one hash partition, so no locks.
+// Compacts `vertices` in place, rewrites `indices` and returns the new vertex count.
+size_t weldVertices(Vertex* vertices, size_t vertexCount, unsigned* indices, size_t indexCount, float epsilon, unsigned threads=0);
+
+// Forsyth's linear-speed greedy triangle order for an LRU cache.
+void optimizeVertexCache(unsigned* indices, size_t indexCount, size_t vertexCount);
+
+// Splits the cache-ordered list into clusters at cache flushes (and where the local ACMR
+// is within `threshold` of the cluster's), then sorts clusters outward-facing first so
+// they tend to occlude the rest. Higher threshold = more clusters, more cache misses.
+void optimizeOverdraw(unsigned* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold=1.05f);
+
+// Quadric edge-collapse simplification of `indices` into `out` (room for indexCount), down
+// to about targetIndexCount or until the next collapse would exceed maxError. Vertices only
+// collapse onto existing ones, so `out` indexes the same vertex array. Vertices on open or
+// non-manifold edges are locked; after welding that includes normal and UV seams, whose
+// split vertices leave open edges on both sides. Returns the new index count; *error gets the
+// largest collapse error (RMS distance to the merged planes, object space).
+size_t simplifyMesh(unsigned* out, const unsigned* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+                    size_t targetIndexCount, float maxError, float* error);
+
+// Renumbers vertices in first-use order and reorders `vertices` to match; unreferenced
+// vertices move to the end. Returns the number of referenced vertices.
+size_t optimizeVertexFetch(Vertex* vertices, size_t vertexCount, unsigned* indices, size_t indexCount);
+
+#endif
@@ -1,16 +1,61 @@
 #include "model.h"
 #include "shader.h"
+#include "draw_batcher.h"
+#include "content_hash.h"
+#include "mapped_file.h"
+#include "mesh_cache.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <limits>
 
-Model::Model(const std::string& path){
+static const unsigned IMPORT_FLAGS=aiProcess_Triangulate|aiProcess_FlipUVs|aiProcess_CalcTangentSpace;
+
+Model::Model(const std::string& path, float weldEpsilon, bool deferUpload){
+    auto t0=std::chrono::steady_clock::now();
+    // keyed by the source bytes and by everything that changes the cooked result
+    std::uint64_t sourceHash=0;
+    {
+        MappedFile source(path);
+        if(source.valid()) sourceHash=hashBytes(source.data(),source.size());
+    }
+    const std::uint64_t settings[]={MESH_CACHE_VERSION,IMPORT_FLAGS,Submesh::MAX_LODS,sizeof(PackedVertex),sizeof(Submesh),sizeof(CookedMeshHeader)};
+    std::uint64_t settingsHash=hashBytes(&weldEpsilon,sizeof(weldEpsilon),hashBytes(settings,sizeof(settings)));
+    std::string cacheFile=meshCacheFile(sourceHash,settingsHash);
+
+    cacheHit=sourceHash && loadCooked(cacheFile,sourceHash,settingsHash);
+    if(!cacheHit){
+        if(!import(path)) return;
+        weldMeshes(weldEpsilon);
+        optimizeMeshes();
+        buildLods();
+        computeBounds();
+        cook(staged);
+        stagedData=staged.data(); stagedBytes=staged.size();
+        if(sourceHash && !submeshes.empty()) saveCooked(cacheFile,sourceHash,settingsHash,staged);
+    }
+    if(!deferUpload) upload();
+    loadMs=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-t0).count();
+    std::cout<<"MESH::CACHE: "<<(cacheHit ? "hit " : sourceHash ? "miss " : "off, source unreadable: ")
+             <<(sourceHash ? cacheFile : path)<<", loaded in "<<loadMs<<" ms"<<std::endl;
+}
+
+bool Model::import(const std::string& path){
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate|aiProcess_FlipUVs|aiProcess_CalcTangentSpace);
-    if(!scene || !scene->mRootNode){ std::cerr<<"ASSIMP: "<<importer.GetErrorString()<<std::endl; return; }
+    const aiScene* scene = importer.ReadFile(path, IMPORT_FLAGS);
+    if(!scene || !scene->mRootNode){ std::cerr<<"ASSIMP: "<<importer.GetErrorString()<<std::endl; return false; }
     for(unsigned i=0;i<scene->mNumMeshes;i++){
         aiMesh* m=scene->mMeshes[i];
+        Submesh sm;
+        sm.firstIndex=(unsigned)indices.size();
+        sm.baseVertex=(GLint)vertices.size();
+        sm.vertexCount=m->mNumVertices;
         for(unsigned j=0;j<m->mNumVertices;j++){
             Vertex v{};
             v.Position = { (float)m->mVertices[j].x,(float)m->mVertices[j].y,(float)m->mVertices[j].z };
@@ -26,22 +71,327 @@ Model::Model(const std::string& path){
             aiFace face = m->mFaces[f];
             for(unsigned k=0;k<face.mNumIndices;k++) indices.push_back(face.mIndices[k]);
         }
+        sm.indexCount=(unsigned)indices.size()-sm.firstIndex;
+        if(sm.indexCount) submeshes.push_back(sm);
+    }
+    return true;
+}
+
+// A hit maps the file and uploads its buffer as-is; any mismatch is treated as a miss.
+bool Model::loadCooked(const std::string& file, std::uint64_t sourceHash, std::uint64_t settingsHash){
+    auto mapped=std::make_unique<MappedFile>(file);
+    const MappedFile& f=*mapped;
+    CookedMeshHeader h;
+    if(!f.valid() || f.size()<sizeof(h)) return false;
+    std::memcpy(&h,f.data(),sizeof(h));
+    if(std::memcmp(h.magic,"8PMESH",6)!=0 || h.version!=MESH_CACHE_VERSION || h.headerBytes!=sizeof(h)
+       || h.sourceHash!=sourceHash || h.settingsHash!=settingsHash) return false;
+    // the header, then every range the draws will read: index ranges inside the index block,
+    // vertex ranges inside the vertex block, both blocks inside the buffer
+    bool ok=h.submeshOffset+(std::uint64_t)h.submeshCount*sizeof(Submesh)<=h.bufferOffset && h.bufferOffset+h.bufferBytes<=f.size()
+        && h.lodCount>=1 && h.lodCount<=Submesh::MAX_LODS && (h.indexSize==2 || h.indexSize==4)
+        && (std::uint64_t)h.indexCount*h.indexSize<=h.vertexOffset
+        && h.vertexOffset+(std::uint64_t)h.vertexCount*sizeof(PackedVertex)<=h.bufferBytes;
+    if(ok){
+        submeshes.resize(h.submeshCount);
+        std::memcpy(submeshes.data(),f.data()+h.submeshOffset,h.submeshCount*sizeof(Submesh));
+        for(const auto& sm: submeshes){
+            ok=ok && sm.baseVertex>=0 && (std::uint64_t)sm.baseVertex+sm.vertexCount<=h.vertexCount
+               && (std::uint64_t)sm.firstIndex+sm.indexCount<=h.indexCount;
+            for(int l=0;l<h.lodCount;l++)
+                ok=ok && (std::uint64_t)sm.lods[l].firstIndex+sm.lods[l].indexCount<=h.indexCount;
+        }
+    }
+    if(!ok){
+        submeshes.clear();
+        std::cout<<"ERROR::MESH_CACHE::CORRUPT: "<<file<<std::endl;
+        return false;
+    }
+    numVertices=h.vertexCount; numIndices=h.indexCount; indexSize=h.indexSize;
+    vertexOffset=(GLintptr)h.vertexOffset;
+    lodCount=h.lodCount;
+    std::copy(h.lodErrors,h.lodErrors+Submesh::MAX_LODS,lodErrors);
+    posScale=h.posScale; posOffset=h.posOffset;
+    boundsMin=h.boundsMin; boundsMax=h.boundsMax; boundsCenter=h.boundsCenter; boundsRadius=h.boundsRadius;
+    importStats=h.importStats; optimizedStats=h.optimizedStats;
+    importedVertices=(size_t)h.importedVertices; weldMs=h.weldMs; optimizeMs=h.optimizeMs;
+    stagedData=f.data()+h.bufferOffset; stagedBytes=(size_t)h.bufferBytes;
+    stagedFile=std::move(mapped);  // keeps the mapping alive until the upload
+    return true;
+}
+
+void Model::saveCooked(const std::string& file, std::uint64_t sourceHash, std::uint64_t settingsHash, const std::vector<unsigned char>& buffer){
+    CookedMeshHeader h{};
+    std::memcpy(h.magic,"8PMESH",6);
+    h.version=MESH_CACHE_VERSION; h.headerBytes=sizeof(h);
+    h.sourceHash=sourceHash; h.settingsHash=settingsHash;
+    h.vertexCount=(std::uint32_t)numVertices; h.indexCount=(std::uint32_t)numIndices;
+    h.indexSize=(std::uint32_t)indexSize; h.submeshCount=(std::uint32_t)submeshes.size();
+    h.lodCount=lodCount;
+    std::copy(lodErrors,lodErrors+Submesh::MAX_LODS,h.lodErrors);
+    h.posScale=posScale; h.posOffset=posOffset;
+    h.boundsMin=boundsMin; h.boundsMax=boundsMax; h.boundsCenter=boundsCenter; h.boundsRadius=boundsRadius;
+    h.importStats=importStats; h.optimizedStats=optimizedStats;
+    h.importedVertices=importedVertices; h.weldMs=weldMs; h.optimizeMs=optimizeMs;
+    h.submeshOffset=sizeof(h);
+    h.bufferOffset=(h.submeshOffset+submeshes.size()*sizeof(Submesh)+15)&~(std::uint64_t)15;
+    h.bufferBytes=buffer.size(); h.vertexOffset=(std::uint64_t)vertexOffset;
+    writeCookedMesh(file,h,submeshes.data(),buffer.data(),buffer.size());
+}
+
+// Welds inside each submesh (indices are mesh-local), then closes the gaps in the vertex array.
+void Model::weldMeshes(float epsilon){
+    auto t0=std::chrono::steady_clock::now();
+    importedVertices=vertices.size();
+    size_t end=0;
+    for(auto& sm: submeshes){
+        size_t n=weldVertices(&vertices[sm.baseVertex],sm.vertexCount,&indices[sm.firstIndex],sm.indexCount,epsilon);
+        if(end!=(size_t)sm.baseVertex)
+            std::move(vertices.begin()+sm.baseVertex,vertices.begin()+sm.baseVertex+n,vertices.begin()+end);
+        sm.baseVertex=(GLint)end; sm.vertexCount=(unsigned)n; end+=n;
+    }
+    vertices.resize(end);
+    weldMs=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-t0).count();
+    std::cout<<"MESH::WELD: "<<importedVertices<<" -> "<<vertices.size()<<" vertices (epsilon "<<epsilon<<", "<<weldMs<<" ms)"<<std::endl;
+}
+
+// Per submesh: vertex cache order, then overdraw clusters, then vertex fetch order.
+void Model::optimizeMeshes(){
+    auto t0=std::chrono::steady_clock::now();
+    for(const auto& sm: submeshes){
+        Vertex* v=&vertices[sm.baseVertex];
+        unsigned* ix=&indices[sm.firstIndex];
+        importStats+=analyzeMesh(v,sm.vertexCount,ix,sm.indexCount);
+        optimizeVertexCache(ix,sm.indexCount,sm.vertexCount);
+        optimizeOverdraw(ix,sm.indexCount,v,sm.vertexCount);
+        optimizeVertexFetch(v,sm.vertexCount,ix,sm.indexCount);
+        optimizedStats+=analyzeMesh(v,sm.vertexCount,ix,sm.indexCount);
+    }
+    optimizeMs=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-t0).count();
+    std::cout<<"MESH::OPTIMIZE: "<<submeshes.size()<<" submeshes, ACMR "<<importStats.acmr()<<" -> "<<optimizedStats.acmr()
+             <<", ATVR "<<importStats.atvr()<<" -> "<<optimizedStats.atvr()
+             <<", overdraw "<<importStats.overdraw()<<" -> "<<optimizedStats.overdraw()<<" ("<<optimizeMs<<" ms)"<<std::endl;
+}
+
+// Each level simplifies the previous one to half its triangles and appends the result to the
+// shared index buffer; a submesh that no longer shrinks reuses its previous range.
+// simplifyMesh measures the error against the level it was given, so a level's error to LOD 0
+// is bounded by the sum along its chain (per submesh; the model keeps the largest).
+void Model::buildLods(){
+    auto t0=std::chrono::steady_clock::now();
+    for(auto& sm: submeshes) sm.lods[0]={sm.firstIndex,sm.indexCount};
+    std::vector<unsigned> out;
+    std::vector<float> chainError(submeshes.size(),0.0f);
+    for(int l=1;l<Submesh::MAX_LODS;l++){
+        bool reduced=false;
+        lodErrors[l]=lodErrors[l-1];
+        for(size_t i=0;i<submeshes.size();i++){
+            Submesh& sm=submeshes[i];
+            Submesh::Range prev=sm.lods[l-1];
+            sm.lods[l]=prev;
+            out.resize(prev.indexCount);
+            float err=0.0f;
+            size_t n=simplifyMesh(out.data(),&indices[prev.firstIndex],prev.indexCount,&vertices[sm.baseVertex],sm.vertexCount,
+                                  prev.indexCount/6*3,std::numeric_limits<float>::max(),&err);
+            if(n==0 || n>prev.indexCount*9/10) continue;  // not worth a level
+            optimizeVertexCache(out.data(),n,sm.vertexCount);
+            sm.lods[l]={(unsigned)indices.size(),(unsigned)n};
+            indices.insert(indices.end(),out.begin(),out.begin()+n);
+            chainError[i]+=err;
+            lodErrors[l]=std::max(lodErrors[l],chainError[i]);
+            reduced=true;
+        }
+        if(!reduced) break;
+        lodCount=l+1;
+    }
+    double ms=std::chrono::duration<double,std::milli>(std::chrono::steady_clock::now()-t0).count();
+    std::cout<<"MESH::LOD: "<<lodCount<<" levels, triangles";
+    for(int l=0;l<lodCount;l++) std::cout<<(l ? " / " : " ")<<triangleCount(l);
+    std::cout<<", max error "<<lodErrors[lodCount-1]<<" ("<<ms<<" ms)"<<std::endl;
+}
+
+size_t Model::triangleCount(int lod) const {
+    size_t n=0;
+    for(const auto& sm: submeshes) n+=sm.lods[lod].indexCount/3;
+    return n;
+}
+
+int Model::selectLod(const LodView& view, const glm::vec3& center, float radius, float scale) const {
+    if(view.maxPixelError<=0.0f) return 0;
+    float distance=std::max(glm::length(center-view.viewPos)-radius,1e-3f);
+    float pixelsPerObjectUnit=view.pixelsPerUnit*scale/distance;
+    int lod=0;
+    while(lod+1<lodCount && lodErrors[lod+1]*pixelsPerObjectUnit<=view.maxPixelError) lod++;
+    return lod;
+}
+
+// AABB, then a sphere around its center that encloses every vertex (tighter than the half-diagonal).
+static void sphereOf(const Vertex* v, size_t n, glm::vec3& bmin, glm::vec3& bmax, glm::vec3& center, float& radius){
+    bmin=bmax=v[0].Position;
+    for(size_t i=0;i<n;i++){ bmin=glm::min(bmin,v[i].Position); bmax=glm::max(bmax,v[i].Position); }
+    center=(bmin+bmax)*0.5f;
+    float r2=0.0f;
+    for(size_t i=0;i<n;i++){ glm::vec3 d=v[i].Position-center; r2=std::max(r2,glm::dot(d,d)); }
+    radius=std::sqrt(r2);
+}
+
+void Model::computeBounds(){
+    if(vertices.empty()) return;
+    sphereOf(vertices.data(),vertices.size(),boundsMin,boundsMax,boundsCenter,boundsRadius);
+    for(auto& sm: submeshes){
+        glm::vec3 mn,mx;
+        if(sm.vertexCount) sphereOf(&vertices[sm.baseVertex],sm.vertexCount,mn,mx,sm.boundsCenter,sm.boundsRadius);
+    }
+}
+
+void Model::worldSphere(const glm::mat4& model, glm::vec3& center, float& radius) const {
+    center=glm::vec3(model*glm::vec4(boundsCenter,1.0f));
+    float s=std::max(glm::length(glm::vec3(model[0])),std::max(glm::length(glm::vec3(model[1])),glm::length(glm::vec3(model[2]))));
+    radius=boundsRadius*s;
+}
+
+// Packs the float vertices into PackedVertex and the indices into 16 bits when every
+// submesh fits (indices are mesh-local, so only the per-mesh vertex count matters). The
+// buffer holds the indices first, padded to 4 bytes, then the vertices: the layout that
+// upload() and the mesh cache share.
+void Model::cook(std::vector<unsigned char>& buffer){
+    glm::vec3 center=(boundsMin+boundsMax)*0.5f;
+    glm::vec3 half=glm::max((boundsMax-boundsMin)*0.5f,glm::vec3(1e-8f));
+    posScale=half/32767.0f; posOffset=center;
+    indexSize=2;
+    for(const auto& sm: submeshes) if(sm.vertexCount>65536) indexSize=4;
+    numVertices=vertices.size(); numIndices=indices.size();
+    vertexOffset=(GLintptr)((numIndices*indexSize+3)&~(size_t)3);
+    buffer.assign((size_t)vertexOffset+numVertices*sizeof(PackedVertex),0);
+
+    if(indexSize==2){
+        std::uint16_t* narrow=(std::uint16_t*)buffer.data();
+        for(size_t i=0;i<numIndices;i++) narrow[i]=(std::uint16_t)indices[i];
+    } else {
+        std::memcpy(buffer.data(),indices.data(),numIndices*sizeof(unsigned));
     }
-    setupMesh();
+    PackedVertex* packed=(PackedVertex*)(buffer.data()+vertexOffset);
+    for(size_t i=0;i<numVertices;i++){
+        const Vertex& v=vertices[i];
+        glm::vec3 q=glm::round(glm::clamp((v.Position-center)/half,-1.0f,1.0f)*32767.0f);
+        PackedVertex& p=packed[i];
+        p.Position[0]=(std::int16_t)q.x; p.Position[1]=(std::int16_t)q.y; p.Position[2]=(std::int16_t)q.z; p.Position[3]=0;
+        glm::vec3 n=glm::dot(v.Normal,v.Normal)>0.0f ? glm::normalize(v.Normal) : glm::vec3(0,0,1);
+        glm::vec3 t=glm::dot(v.Tangent,v.Tangent)>0.0f ? glm::normalize(v.Tangent) : glm::vec3(1,0,0);
+        float w=glm::dot(glm::cross(n,t),v.Bitangent)<0.0f ? -1.0f : 1.0f;
+        p.Normal=glm::packSnorm3x10_1x2(glm::vec4(n,0.0f));
+        p.Tangent=glm::packSnorm3x10_1x2(glm::vec4(t,w));
+        p.TexCoords=glm::packHalf2x16(v.TexCoords);
+    }
+}
+
+// One glBufferData for indices and vertices; the VAO reads both from the same buffer.
+void Model::upload(){
+    GLuint buffer=0;
+    glGenBuffers(1,&buffer);
+    glBindBuffer(GL_ARRAY_BUFFER,buffer);
+    glBufferData(GL_ARRAY_BUFFER,stagedBytes,stagedData,GL_STATIC_DRAW);
+    finishUpload(buffer);
 }
 
-void Model::setupMesh(){
-    glGenVertexArrays(1,&VAO); glGenBuffers(1,&VBO); glGenBuffers(1,&EBO);
+void Model::finishUpload(GLuint buffer){
+    meshBuffer=buffer;
+    glGenVertexArrays(1,&VAO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER,meshBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,meshBuffer);
+    // integer positions are converted to float as-is (not normalized) so dequantization is exact
+    const char* base=(const char*)vertexOffset;
+    glEnableVertexAttribArray(0); glVertexAttribPointer(0,3,GL_SHORT,GL_FALSE,sizeof(PackedVertex),base);
+    glEnableVertexAttribArray(1); glVertexAttribPointer(1,4,GL_INT_2_10_10_10_REV,GL_TRUE,sizeof(PackedVertex),base+offsetof(PackedVertex,Normal));
+    glEnableVertexAttribArray(2); glVertexAttribPointer(2,2,GL_HALF_FLOAT,GL_FALSE,sizeof(PackedVertex),base+offsetof(PackedVertex,TexCoords));
+    glEnableVertexAttribArray(3); glVertexAttribPointer(3,4,GL_INT_2_10_10_10_REV,GL_TRUE,sizeof(PackedVertex),base+offsetof(PackedVertex,Tangent));
+    glBindVertexArray(0);
+
+    for(int l=0;l<lodCount;l++) for(const auto& sm: submeshes){
+        drawCounts.push_back((GLsizei)sm.lods[l].indexCount);
+        drawOffsets.push_back((const void*)((size_t)sm.lods[l].firstIndex*indexSize));
+        drawBaseVertices.push_back(sm.baseVertex);
+    }
+    std::vector<unsigned char>().swap(staged);
+    stagedFile.reset();
+    stagedData=nullptr; stagedBytes=0;
+}
+
+Model::~Model(){
+    if(VAO) glDeleteVertexArrays(1,&VAO);
+    if(meshBuffer) glDeleteBuffers(1,&meshBuffer);
+}
+
+void Model::setDequantization(Shader& shader, const DequantizationUniforms& dq) const {
+    shader.set(dq.posScale,posScale);
+    shader.set(dq.posOffset,posOffset);
+}
+// All submeshes in one call: the same VAO, rebased per mesh by baseVertex.
+void Model::Draw(Shader& shader, const DequantizationUniforms& dq, int lod){
+    if(submeshes.empty()) return;
+    setDequantization(shader,dq);
+    size_t first=(size_t)lod*submeshes.size();
     glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER,VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size()*sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size()*sizeof(unsigned), indices.data(), GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0); glVertexAttribPointer(0,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)0);
-    glEnableVertexAttribArray(1); glVertexAttribPointer(1,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,Normal));
-    glEnableVertexAttribArray(2); glVertexAttribPointer(2,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,TexCoords));
-    glEnableVertexAttribArray(3); glVertexAttribPointer(3,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,Tangent));
-    glEnableVertexAttribArray(4); glVertexAttribPointer(4,3,GL_FLOAT,GL_FALSE,sizeof(Vertex),(void*)offsetof(Vertex,Bitangent));
+    glMultiDrawElementsBaseVertex(GL_TRIANGLES,&drawCounts[first],indexType(),&drawOffsets[first],(GLsizei)submeshes.size(),&drawBaseVertices[first]);
+    glBindVertexArray(0);
+}
+
+// Expects VAO bound; re-points the instance attributes only when the source changes.
+void Model::pointInstanceAttribs(GLuint buffer, GLintptr offset){
+    if(buffer==instanceSource && offset==instanceSourceOffset) return;
+    glBindBuffer(GL_ARRAY_BUFFER,buffer);
+    for(int c=0;c<4;c++){ // mat4 = 4 vec4 columns
+        glEnableVertexAttribArray(5+c);
+        glVertexAttribPointer(5+c,4,GL_FLOAT,GL_FALSE,sizeof(InstanceData),(void*)(offset+offsetof(InstanceData,Model)+c*sizeof(glm::vec4)));
+        glVertexAttribDivisor(5+c,1);
+    }
+    glEnableVertexAttribArray(9); glVertexAttribPointer(9,4,GL_FLOAT,GL_FALSE,sizeof(InstanceData),(void*)(offset+offsetof(InstanceData,Material)));
+    glVertexAttribDivisor(9,1);
+    instanceSource=buffer; instanceSourceOffset=offset;
+}
+
+InstanceSet::~InstanceSet(){
+    if(buffer) glDeleteBuffers(1,&buffer);
+}
+
+void InstanceSet::set(const std::vector<InstanceData>& instances){
+    static unsigned versions=0;
+    data=instances;
+    version=++versions;
+    if(!buffer) glGenBuffers(1,&buffer);
+    glBindBuffer(GL_ARRAY_BUFFER,buffer);
+    glBufferData(GL_ARRAY_BUFFER,data.size()*sizeof(InstanceData),data.data(),GL_STATIC_DRAW);
+}
+
+void Model::DrawInstanced(Shader& shader, const DequantizationUniforms& dq, const InstanceSet& set, int lod){
+    if(set.data.empty()) return;
+    setDequantization(shader,dq);
+    glBindVertexArray(VAO); pointInstanceAttribs(set.buffer,0);
+    for(const auto& sm: submeshes)
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES,(GLsizei)sm.lods[lod].indexCount,indexType(),
+            (void*)((size_t)sm.lods[lod].firstIndex*indexSize),set.count(),sm.baseVertex);
+    glBindVertexArray(0);
+}
+
+void Model::DrawBatch(Shader& shader, const DequantizationUniforms& dq, const DrawBatcher& batch){
+    const auto& cmds=batch.commands();
+    if(cmds.empty()) return;
+    setDequantization(shader,dq);
+    glBindVertexArray(VAO);
+    if(batch.multiDraw()){
+        // baseInstance offsets the instance attributes, so per-draw data needs no gl_DrawID
+        if(batch.instanced()) pointInstanceAttribs(batch.instanceBuffer(),0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER,batch.indirectBuffer());
+        glMultiDrawElementsIndirect(GL_TRIANGLES,indexType(),nullptr,(GLsizei)cmds.size(),0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER,0);
+    } else {
+        // GL 3.3: no baseInstance, so each command re-points the instance attributes instead
+        for(const auto& c: cmds){
+            if(batch.instanced()) pointInstanceAttribs(batch.instanceBuffer(),(GLintptr)c.baseInstance*sizeof(InstanceData));
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES,(GLsizei)c.count,indexType(),
+                (void*)((size_t)c.firstIndex*indexSize),(GLsizei)c.instanceCount,c.baseVertex);
+        }
+    }
     glBindVertexArray(0);
 }
-void Model::Draw(Shader&){ glBindVertexArray(VAO); glDrawElements(GL_TRIANGLES,(GLsizei)indices.size(),GL_UNSIGNED_INT,0); glBindVertexArray(0); }
@@ -4,10 +4,15 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
+#include "mesh_optimizer.h"
+#include "shader.h"
 
-class Shader;
+class DrawBatcher;
+class MappedFile;
 
 struct Vertex {
     glm::vec3 Position;
@@ -18,14 +23,144 @@ struct Vertex {
     Vertex():Position(0),Normal(0),TexCoords(0),Tangent(0),Bitangent(0) {}
 };
 
+// GPU vertex, 20 bytes instead of the 56 of Vertex (attribute formats in setupMesh).
+struct PackedVertex {
+    std::int16_t  Position[4];  // quantized to the model bounds, dequantized by posScale/posOffset; w = 0
+    std::uint32_t Normal;       // snorm 10:10:10:2
+    std::uint32_t Tangent;      // snorm 10:10:10, 2-bit w = handedness of the bitangent
+    std::uint32_t TexCoords;    // 2 x half float
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+// Per-instance vertex data, attributes 5..9 of vertex.shader when INSTANCED.
+struct InstanceData {
+    glm::mat4 Model;     // applied after the uniform model matrix
+    glm::vec4 Material;  // rgb = albedo tint, a = shininess scale
+};
+
+// Instances in their own buffer, drawn with any Model: scene objects that share a mesh each
+// keep a set. The CPU copy stays for culling.
+struct InstanceSet {
+    std::vector<InstanceData> data;
+    unsigned     version=0;  // bumped by set, unique across sets
+    unsigned int buffer=0;
+    InstanceSet()=default;
+    InstanceSet(InstanceSet&& o) noexcept : data(std::move(o.data)), version(o.version), buffer(o.buffer) { o.buffer=0; }
+    InstanceSet(const InstanceSet&)=delete;
+    InstanceSet& operator=(const InstanceSet&)=delete;
+    ~InstanceSet();
+    void set(const std::vector<InstanceData>& instances);
+    GLsizei count() const { return (GLsizei)data.size(); }
+};
+
+// One aiMesh inside the shared vertex/index buffers. Indices stay mesh-local and are
+// rebased at draw time with baseVertex.
+struct Submesh {
+    static const int MAX_LODS=4;
+    struct Range { unsigned int firstIndex=0, indexCount=0; };
+    unsigned int firstIndex=0, indexCount=0;  // LOD 0
+    GLint        baseVertex=0;
+    unsigned int vertexCount=0;
+    glm::vec3    boundsCenter{0.0f};  // object-space bounding sphere
+    float        boundsRadius=0.0f;
+    Range        lods[MAX_LODS];      // lods[0] = LOD 0; coarser levels follow all LOD 0 indices
+};
+
+// posScale/posOffset handles of a program that draws models; resolved with the program's other
+// uniforms (its bindings struct) and passed to every draw.
+struct DequantizationUniforms {
+    Uniform<glm::vec3> posScale, posOffset;
+};
+
+// What Model::selectLod needs from the camera. pixelsPerUnit = viewport height / (2 tan(fovY/2)),
+// the on-screen size of one unit at distance 1. maxPixelError <= 0 always picks LOD 0.
+struct LodView {
+    glm::vec3 viewPos{0.0f};
+    float     pixelsPerUnit=1.0f;
+    float     maxPixelError=0.0f;
+};
+
 class Model {
 public:
+    // CPU copies from the import; empty when the model came from the mesh cache.
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
-    Model(const std::string& path);
-    void Draw(Shader& shader);
+    std::vector<Submesh> submeshes;
+    InstanceSet instances;                // the model's own instances (stress grid)
+    // Object-space bounds, computed once at load.
+    glm::vec3 boundsMin{0.0f}, boundsMax{0.0f};
+    glm::vec3 boundsCenter{0.0f};
+    float     boundsRadius=0.0f;
+    // Cache/overdraw stats as imported and after optimizeMeshes, summed over submeshes.
+    MeshStats importStats, optimizedStats;
+    double    optimizeMs=0.0;
+    size_t    importedVertices=0;  // before welding
+    double    weldMs=0.0;
+    // Vertices whose attributes round to the same multiple of weldEpsilon are merged (0 = exact).
+    static constexpr float WELD_EPSILON=1e-6f;
+    // LOD chain: lodErrors[l] is the object-space simplification error of level l (0 for LOD 0).
+    int       lodCount=1;
+    float     lodErrors[Submesh::MAX_LODS]={};
+    // Mesh cache (mesh_cache.h): whether this load skipped the import, and its total time.
+    bool      cacheHit=false;
+    double    loadMs=0.0;
+    // Every CPU step runs here and never touches GL when deferUpload is set, so the
+    // constructor can run on a worker thread; the GL thread then fills a buffer with
+    // stagedBuffer() and hands it to finishUpload().
+    Model(const std::string& path, float weldEpsilon=WELD_EPSILON, bool deferUpload=false);
+    ~Model();
+    Model(const Model&)=delete;
+    Model& operator=(const Model&)=delete;
+    bool uploaded() const { return VAO!=0; }
+    const unsigned char* stagedBuffer() const { return stagedData; }
+    size_t stagedBufferBytes() const { return stagedBytes; }
+    void finishUpload(GLuint buffer);
+    void Draw(Shader& shader, const DequantizationUniforms& dq, int lod=0);
+    // Draws every instance of the set in one call per submesh.
+    void DrawInstanced(Shader& shader, const DequantizationUniforms& dq, const InstanceSet& set, int lod=0);
+    // Draws the command list of a DrawBatcher built for this model (one multi-draw when available).
+    void DrawBatch(Shader& shader, const DequantizationUniforms& dq, const DrawBatcher& batch);
+    size_t triangleCount(int lod=0) const;
+    // Coarsest LOD whose error, scaled by `scale` and seen from the nearest point of the
+    // sphere (center, radius), projects below view.maxPixelError.
+    int selectLod(const LodView& view, const glm::vec3& center, float radius, float scale) const;
+    size_t vertexCount() const { return numVertices; }
+    // GPU memory of the packed layout, and of the float Vertex + 32-bit index layout it replaces.
+    size_t vertexBytes() const { return numVertices*sizeof(PackedVertex); }
+    size_t indexBytes() const { return numIndices*indexSize; }
+    size_t floatLayoutBytes() const { return numVertices*sizeof(Vertex)+numIndices*sizeof(unsigned); }
+    GLenum indexType() const { return indexSize==2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+    // Bounding sphere after the model matrix (radius scaled by its largest axis scale).
+    void worldSphere(const glm::mat4& model, glm::vec3& center, float& radius) const;
 private:
-    unsigned int VAO=0,VBO=0,EBO=0;
-    void setupMesh();
+    // One buffer holds the indices (padded to 4 bytes) and then the packed vertices at vertexOffset.
+    unsigned int VAO=0, meshBuffer=0;
+    GLintptr  vertexOffset=0;
+    size_t    numVertices=0, numIndices=0;
+    // GPU buffer contents until the upload: the cooked bytes, or a view into the mapped cache file
+    std::vector<unsigned char>  staged;
+    std::unique_ptr<MappedFile> stagedFile;
+    const unsigned char*        stagedData=nullptr;
+    size_t                      stagedBytes=0;
+    size_t    indexSize=4;          // 2 when every submesh has at most 65536 vertices
+    glm::vec3 posScale{1.0f}, posOffset{0.0f};
+    // Buffer/offset attributes 5..9 currently read from (the batcher's buffer during DrawBatch)
+    unsigned int instanceSource=0;
+    GLintptr     instanceSourceOffset=0;
+    // glMultiDrawElementsBaseVertex arrays, one entry per submesh, LOD after LOD
+    std::vector<GLsizei>     drawCounts;
+    std::vector<const void*> drawOffsets;
+    std::vector<GLint>       drawBaseVertices;
+    void weldMeshes(float epsilon);
+    void optimizeMeshes();
+    void buildLods();
+    bool import(const std::string& path);
+    void cook(std::vector<unsigned char>& buffer);
+    void upload();
+    bool loadCooked(const std::string& file, std::uint64_t sourceHash, std::uint64_t settingsHash);
+    void saveCooked(const std::string& file, std::uint64_t sourceHash, std::uint64_t settingsHash, const std::vector<unsigned char>& buffer);
+    void pointInstanceAttribs(GLuint buffer, GLintptr offset);
+    void setDequantization(Shader& shader, const DequantizationUniforms& dq) const;
+    void computeBounds();
 };
 #endif
@@ -0,0 +1,84 @@
+#include "model_loader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// Only joins the worker: a global loader outlives the GL context, which frees the staging buffer.
+ModelLoader::~ModelLoader() {
+    if (worker_.joinable()) worker_.join();
+}
+
+bool ModelLoader::start(const std::string& path, float weldEpsilon) {
+    if (busy()) { std::cout << "WARNING::MODEL_LOADER::BUSY: " << path_ << std::endl; return false; }
+    path_ = path;
+    stage_ = Stage::Loading;
+    loaded_ = false;
+    lastStallMs_ = 0.0;
+    worker_ = std::thread([this, path, weldEpsilon] {
+        model_.reset(new Model(path, weldEpsilon, true));
+        loaded_ = true;  // publishes model_ to the render thread
+    });
+    return true;
+}
+
+float ModelLoader::progress() const {
+    if (stage_ != Stage::Uploading || !model_) return 0.0f;
+    return (float)uploadedBytes_ / std::max<size_t>(model_->stagedBufferBytes(), 1);
+}
+
+Model* ModelLoader::poll() {
+    if (stage_ == Stage::Idle) return nullptr;
+    if (stage_ == Stage::Loading) {
+        if (!loaded_) return nullptr;
+        worker_.join();
+        if (model_->submeshes.empty()) {  // import failed (already logged); keep the current model
+            model_.reset();
+            stage_ = Stage::Idle;
+            return nullptr;
+        }
+        glGenBuffers(1, &staging_);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, staging_);
+        glBufferData(GL_COPY_WRITE_BUFFER, model_->stagedBufferBytes(), nullptr, GL_STREAM_COPY);
+        uploadedBytes_ = 0;
+        stage_ = Stage::Uploading;
+    }
+
+    // one slice into the staging buffer per frame; the frame after the last slice copies it
+    // into the final buffer on the GPU and builds the VAO
+    auto t0 = std::chrono::high_resolution_clock::now();
+    const size_t total = model_->stagedBufferBytes();
+    Model* done = nullptr;
+    if (uploadedBytes_ < total) {
+        size_t n = std::min(UPLOAD_BYTES_PER_FRAME, total - uploadedBytes_);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, staging_);
+        void* dst = glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)uploadedBytes_, (GLsizeiptr)n,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        if (dst) {
+            std::memcpy(dst, model_->stagedBuffer() + uploadedBytes_, n);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        } else {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)uploadedBytes_, (GLsizeiptr)n, model_->stagedBuffer() + uploadedBytes_);
+        }
+        uploadedBytes_ += n;
+    } else {
+        GLuint buffer = 0;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_READ_BUFFER, staging_);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, total, nullptr, GL_STATIC_DRAW);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, total);
+        glDeleteBuffers(1, &staging_);  // freed by the driver once the copy has run
+        staging_ = 0;
+        model_->finishUpload(buffer);
+        done = model_.release();
+        stage_ = Stage::Idle;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+    lastStallMs_ = std::max(lastStallMs_, ms);
+    longestStallMs_ = std::max(longestStallMs_, ms);
+    if (done)
+        std::cout << "MODEL_LOADER: " << path_ << " ready, " << total / 1024 << " KB uploaded, longest upload stall "
+                  << lastStallMs_ << " ms" << std::endl;
+    return done;
+}
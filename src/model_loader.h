@@ -0,0 +1,47 @@
+#pragma once
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include "model.h"
+
+// Loads a Model on a worker thread (import, weld, optimize, LODs, cook, or a mesh cache hit),
+// then uploads it from the render thread a slice per frame through a staging buffer, so
+// neither the import nor the upload stalls a frame. The current model keeps drawing until
+// poll() hands over the new one.
+class ModelLoader {
+public:
+    static const size_t UPLOAD_BYTES_PER_FRAME = 8u << 20;
+
+    ~ModelLoader();
+    // Starts loading `path`; false while another load is still in flight.
+    bool start(const std::string& path, float weldEpsilon);
+    bool busy() const { return stage_ != Stage::Idle; }
+
+    // Render thread, once per frame: advances the upload and returns the finished model
+    // (ownership passes to the caller) or nullptr.
+    Model* poll();
+
+    const std::string& path() const { return path_; }
+    float  progress() const;                                // 0..1 of the current load
+    bool   uploading() const { return stage_ == Stage::Uploading; }
+    double lastStallMs() const { return lastStallMs_; }     // longest upload step of the last load
+    double longestStallMs() const { return longestStallMs_; }  // over every load
+
+private:
+    enum class Stage { Idle, Loading, Uploading };
+    Stage stage_ = Stage::Idle;
+    std::string path_;
+    std::thread worker_;
+    std::atomic<bool> loaded_{ false };
+    std::unique_ptr<Model> model_;
+    GLuint staging_ = 0;
+    size_t uploadedBytes_ = 0;
+    double lastStallMs_ = 0.0, longestStallMs_ = 0.0;
+};
+
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <vector>
+
+// Runs f(0..threads-1), f(0) on the calling thread.
+template<class F> void parallelFor(unsigned threads, F f){
+    std::vector<std::thread> pool;
+    for(unsigned t=1;t<threads;t++) pool.emplace_back(f,t);
+    f(0);
+    for(auto& th: pool) th.join();
+}
+
+#endif
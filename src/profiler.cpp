@@ -0,0 +1,188 @@
+#include "profiler.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const double CLOCK_SYNC_MS = 1000.0;
+
+double Profiler::Frame::gpuMs() const {
+    double ms = 0.0;
+    if (gpuValid)
+        for (const Zone& z : zones)
+            if (z.gpuDepth == 0) ms += z.gpuEnd - z.gpuBegin;
+    return ms;
+}
+
+double Profiler::Frame::cpuMs(const char* name) const {
+    double ms = 0.0;
+    for (const Zone& z : zones)
+        if (std::strcmp(z.name, name) == 0) ms += z.cpuEnd - z.cpuBegin;
+    return ms;
+}
+
+double Profiler::Frame::gpuMs(const char* name) const {
+    double ms = 0.0;
+    if (gpuValid)
+        for (const Zone& z : zones)
+            if (z.gpuDepth >= 0 && std::strcmp(z.name, name) == 0) ms += z.gpuEnd - z.gpuBegin;
+    return ms;
+}
+
+bool Profiler::Frame::has(const char* name) const {
+    for (const Zone& z : zones)
+        if (std::strcmp(z.name, name) == 0) return true;
+    return false;
+}
+
+void Profiler::init(bool gpuTimers) {
+    gpuTimers_ = gpuTimers;
+    if (!gpuTimers_) return;
+    queries_.resize((size_t)QUERY_FRAMES * 2 * MAX_ZONES);
+    glGenQueries((GLsizei)queries_.size(), queries_.data());
+    slotBusy_.assign(QUERY_FRAMES, false);
+}
+
+void Profiler::shutdown() {
+    if (!queries_.empty()) glDeleteQueries((GLsizei)queries_.size(), queries_.data());
+    queries_.clear();
+    gpuTimers_ = false;
+}
+
+double Profiler::now() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - epoch_).count();
+}
+
+void Profiler::beginFrame() {
+    if (gpuTimers_) resolve();
+    if (!enabled_) return;
+
+    current_ = Frame();
+    if (!spare_.empty()) { current_.zones = std::move(spare_.back()); spare_.pop_back(); }
+    current_.zones.clear();
+    current_.zones.reserve(MAX_ZONES);
+    current_.index = frameIndex_++;
+    current_.cpuBegin = now();
+    open_.clear();
+    openGpu_ = 0;
+    lastQuery_ = -1;
+    inFrame_ = true;
+
+    if (!gpuTimers_) return;
+    // the slot QUERY_FRAMES frames back is still unread: give up its GPU times rather than wait
+    slot_ = (int)(current_.index % QUERY_FRAMES);
+    while (slotBusy_[slot_]) {
+        Pending& p = pending_.front();
+        slotBusy_[p.slot] = false;
+        retire(std::move(p.frame));
+        pending_.pop_front();
+        droppedGpuFrames_++;
+    }
+    if (current_.cpuBegin - lastSync_ >= CLOCK_SYNC_MS) {
+        GLint64 ns = 0;
+        glGetInteger64v(GL_TIMESTAMP, &ns);
+        clockOffset_ = now() - ns / 1e6;
+        lastSync_ = current_.cpuBegin;
+    }
+}
+
+void Profiler::endFrame() {
+    if (!inFrame_) return;
+    while (!open_.empty()) endZone(open_.back());  // scopes still open end with the frame
+    current_.cpuEnd = now();
+    inFrame_ = false;
+    if (!gpuTimers_) { retire(std::move(current_)); return; }
+    slotBusy_[slot_] = true;
+    pending_.push_back({ std::move(current_), slot_, lastQuery_, clockOffset_ });
+}
+
+int Profiler::beginZone(const char* name, bool gpu) {
+    if (!inFrame_) return -1;
+    if ((int)current_.zones.size() >= MAX_ZONES) { droppedZones_++; return -1; }
+    int zone = (int)current_.zones.size();
+    gpu = gpu && gpuTimers_;
+    current_.zones.push_back({ name, (int)open_.size(), gpu ? openGpu_ : -1, now(), 0.0, 0.0, 0.0 });
+    open_.push_back(zone);
+    if (gpu) {
+        openGpu_++;
+        glQueryCounter(queries_[((size_t)slot_ * MAX_ZONES + zone) * 2], GL_TIMESTAMP);
+    }
+    return zone;
+}
+
+void Profiler::endZone(int zone) {
+    if (zone < 0 || open_.empty() || open_.back() != zone) return;  // closed by endFrame()
+    Zone& z = current_.zones[zone];
+    if (z.gpuDepth >= 0) {
+        lastQuery_ = (int)(((size_t)slot_ * MAX_ZONES + zone) * 2 + 1);
+        glQueryCounter(queries_[lastQuery_], GL_TIMESTAMP);
+        openGpu_--;
+    }
+    z.cpuEnd = now();
+    open_.pop_back();
+}
+
+// Timestamps complete in order, so a frame is done once its last query is.
+void Profiler::resolve() {
+    while (!pending_.empty()) {
+        Pending& p = pending_.front();
+        if (p.lastQuery >= 0) {
+            GLuint available = 0;
+            glGetQueryObjectuiv(queries_[p.lastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) break;
+            for (size_t i = 0; i < p.frame.zones.size(); ++i) {
+                Zone& z = p.frame.zones[i];
+                if (z.gpuDepth < 0) continue;
+                GLuint64 begin = 0, end = 0;
+                glGetQueryObjectui64v(queries_[((size_t)p.slot * MAX_ZONES + i) * 2], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(queries_[((size_t)p.slot * MAX_ZONES + i) * 2 + 1], GL_QUERY_RESULT, &end);
+                z.gpuBegin = begin / 1e6 + p.clockOffset;
+                z.gpuEnd = end / 1e6 + p.clockOffset;
+            }
+            p.frame.gpuValid = true;
+        }
+        slotBusy_[p.slot] = false;
+        retire(std::move(p.frame));
+        pending_.pop_front();
+    }
+}
+
+void Profiler::retire(Frame&& frame) {
+    history_.push_back(std::move(frame));
+    if ((int)history_.size() > HISTORY_FRAMES) {
+        spare_.push_back(std::move(history_.front().zones));
+        history_.pop_front();
+    }
+}
+
+const Profiler::Frame* Profiler::latestGpu() const {
+    for (auto it = history_.rbegin(); it != history_.rend(); ++it)
+        if (it->gpuValid) return &*it;
+    return nullptr;
+}
+
+bool Profiler::exportChromeTrace(const std::string& file) const {
+    std::ofstream out(file, std::ios::trunc);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU (render thread)\"}},\n"
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    char line[256];
+    auto event = [&](const char* name, int tid, double beginMs, double endMs) {
+        std::snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+            name, tid, beginMs * 1000.0, (endMs - beginMs) * 1000.0);
+        out << line;
+    };
+    for (const Frame& f : history_) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame %llu", f.index);
+        event(name, 1, f.cpuBegin, f.cpuEnd);
+        for (const Zone& z : f.zones) {
+            event(z.name, 1, z.cpuBegin, z.cpuEnd);
+            if (f.gpuValid && z.gpuDepth >= 0) event(z.name, 2, z.gpuBegin, z.gpuEnd);
+        }
+    }
+    out << "\n]}\n";
+    if (!out) { std::cout << "WARNING::PROFILER::TRACE_WRITE_FAILED: " << file << std::endl; return false; }
+    std::cout << "PROFILER::TRACE: " << history_.size() << " frames written to " << file << std::endl;
+    return true;
+}
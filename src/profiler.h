@@ -0,0 +1,107 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+// Frame profiler for the render thread. Named zones are opened with Profiler::Scope and nest;
+// GPU zones also drop a GL_TIMESTAMP query at each end. Timestamps rather than
+// GL_TIME_ELAPSED because elapsed queries cannot nest. Each frame owns its own set of
+// queries in a ring QUERY_FRAMES deep and is read back only once its last query is
+// available, so reading never waits on the GPU. If the ring wraps first, the frame keeps its
+// CPU times only. GPU timestamps are moved onto the CPU clock with an offset sampled from
+// glGetInteger64v(GL_TIMESTAMP) about once a second, so both timelines share one axis.
+// Resolved frames go into a history for the flame view and Chrome trace export.
+class Profiler {
+public:
+    static const int QUERY_FRAMES = 6;      // frames of GPU queries in flight
+    static const int MAX_ZONES = 256;       // per frame (scenes open zones per object); the extra zones are dropped
+    static const int HISTORY_FRAMES = 300;  // resolved frames kept
+
+    struct Zone {
+        const char* name;         // a string literal, kept by pointer
+        int    depth;             // nesting among all zones
+        int    gpuDepth;          // nesting among GPU zones, -1 for CPU-only zones
+        double cpuBegin, cpuEnd;  // ms on the profiler clock
+        double gpuBegin, gpuEnd;  // ms on the profiler clock once resolved
+    };
+    struct Frame {
+        unsigned long long index = 0;
+        double cpuBegin = 0.0, cpuEnd = 0.0;
+        bool   gpuValid = false;  // GPU times resolved (false without timer queries or when the ring wrapped)
+        std::vector<Zone> zones;  // in the order they were opened
+
+        double cpuMs() const { return cpuEnd - cpuBegin; }
+        double cpuMs(const char* name) const;  // sum of the zones named `name`
+        double gpuMs() const;                  // sum of the outermost GPU zones
+        double gpuMs(const char* name) const;  // sum of the GPU zones named `name`
+        bool   has(const char* name) const;
+    };
+
+    // RAII zone; does nothing while the profiler is disabled or outside a frame.
+    class Scope {
+    public:
+        Scope(Profiler& p, const char* name, bool gpu = false) : p_(p), zone_(p.beginZone(name, gpu)) {}
+        ~Scope() { p_.endZone(zone_); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        Profiler& p_;
+        int zone_;
+    };
+
+    // `gpuTimers`: the context supports GL_TIMESTAMP queries (GL 3.3 or ARB_timer_query).
+    void init(bool gpuTimers);
+    void shutdown();  // deletes the queries; needs the context
+
+    // Brackets one frame; beginFrame() also reads back the frames whose queries are done.
+    void beginFrame();
+    void endFrame();
+
+    void setEnabled(bool on) { enabled_ = on; }
+    bool enabled() const { return enabled_; }
+    bool gpuTimers() const { return gpuTimers_; }
+    unsigned long long frameIndex() const { return frameIndex_; }  // index the next frame gets
+
+    const std::deque<Frame>& history() const { return history_; }  // oldest first
+    const Frame* latest() const { return history_.empty() ? nullptr : &history_.back(); }
+    const Frame* latestGpu() const;        // newest frame with GPU times
+    size_t droppedGpuFrames() const { return droppedGpuFrames_; }
+    size_t droppedZones() const { return droppedZones_; }
+
+    // Writes the history as Chrome trace JSON (chrome://tracing, Perfetto): CPU zones on one
+    // track, GPU zones on another, times in microseconds. Returns false (and logs) on failure.
+    bool exportChromeTrace(const std::string& file) const;
+
+private:
+    struct Pending { Frame frame; int slot; int lastQuery; double clockOffset; };
+
+    int  beginZone(const char* name, bool gpu);
+    void endZone(int zone);
+    void resolve();
+    void retire(Frame&& frame);
+    double now() const;
+
+    bool enabled_ = true;
+    bool gpuTimers_ = false;
+    bool inFrame_ = false;
+    std::chrono::steady_clock::time_point epoch_ = std::chrono::steady_clock::now();
+    std::vector<GLuint> queries_;          // QUERY_FRAMES slots of 2 * MAX_ZONES
+    std::vector<bool>   slotBusy_;
+    unsigned long long frameIndex_ = 0;
+    Frame  current_;
+    int    slot_ = 0, lastQuery_ = -1;
+    std::vector<int> open_;                // zone stack
+    int    openGpu_ = 0;
+    double clockOffset_ = 0.0, lastSync_ = -1e9;  // CPU ms minus GPU ms
+    std::deque<Pending> pending_;
+    std::deque<Frame> history_;
+    std::vector<std::vector<Zone>> spare_; // zone storage recycled from retired frames
+    size_t droppedGpuFrames_ = 0, droppedZones_ = 0;
+};
+
+#endif
@@ -0,0 +1,308 @@
+#include "scene_file.h"
+#include "mapped_file.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <charconv>
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+// Pull reader over the raw JSON bytes. The first error is logged and sticks: every later
+// call returns false, so the callers just bail out on false.
+class JsonReader {
+public:
+    JsonReader(const char* begin, const char* end, const std::string& file)
+        : begin_(begin), p_(begin), end_(end), file_(file) {}
+
+    bool ok() const { return ok_; }
+
+    bool fail(const char* what) {
+        if (!ok_) return false;
+        ok_ = false;
+        int line = 1, col = 1;  // counted only here, so the hot path never tracks lines
+        for (const char* c = begin_; c < p_; ++c) {
+            if (*c == '\n') { line++; col = 1; }
+            else col++;
+        }
+        std::cout << "ERROR::SCENE::PARSE: " << file_ << ":" << line << ":" << col << ": " << what << std::endl;
+        return false;
+    }
+
+    void ws() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+    }
+    bool peek(char c) { ws(); return p_ < end_ && *p_ == c; }
+    bool expect(char c, const char* what) {
+        if (!ok_) return false;
+        if (peek(c)) { ++p_; return true; }
+        return fail(what);
+    }
+    bool atEnd() { ws(); return p_ == end_; }
+
+    bool string(std::string& out) {
+        out.clear();
+        if (!expect('"', "expected a string")) return false;
+        while (p_ < end_) {
+            const char* run = p_;
+            while (p_ < end_ && *p_ != '"' && *p_ != '\\') ++p_;
+            out.append(run, p_);
+            if (p_ == end_) break;
+            if (*p_++ == '"') return true;
+            if (p_ == end_) break;
+            char e = *p_++;
+            switch (e) {
+            case '"': case '\\': case '/': out += e; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                unsigned cp = 0;
+                if (end_ - p_ < 4 || std::from_chars(p_, p_ + 4, cp, 16).ptr != p_ + 4) return fail("bad \\u escape");
+                p_ += 4;
+                // UTF-8; surrogate pairs are not combined (paths in scene files are rarely astral)
+                if (cp < 0x80) out += (char)cp;
+                else if (cp < 0x800) { out += (char)(0xC0 | (cp >> 6)); out += (char)(0x80 | (cp & 63)); }
+                else { out += (char)(0xE0 | (cp >> 12)); out += (char)(0x80 | ((cp >> 6) & 63)); out += (char)(0x80 | (cp & 63)); }
+                break;
+            }
+            default: --p_; return fail("bad escape in string");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool number(float& out) {
+        if (!ok_) return false;
+        ws();
+        auto r = std::from_chars(p_, end_, out);
+        if (r.ec == std::errc::invalid_argument) return fail("expected a number");
+        if (r.ec == std::errc::result_out_of_range) return fail("number out of range");
+        p_ = r.ptr;
+        return true;
+    }
+
+    bool boolean(bool& out) {
+        if (!ok_) return false;
+        ws();
+        if (end_ - p_ >= 4 && !std::memcmp(p_, "true", 4)) { out = true; p_ += 4; return true; }
+        if (end_ - p_ >= 5 && !std::memcmp(p_, "false", 5)) { out = false; p_ += 5; return true; }
+        return fail("expected true or false");
+    }
+
+    // Fixed-length numeric array; a single number for a vec3 fills all three.
+    bool floats(float* out, int n, bool splat = false) {
+        if (splat && !peek('[')) {
+            if (!number(out[0])) return false;
+            for (int i = 1; i < n; ++i) out[i] = out[0];
+            return true;
+        }
+        if (!expect('[', "expected an array of numbers")) return false;
+        for (int i = 0; i < n; ++i) {
+            if (i && !expect(',', "expected ',' (array too short?)")) return false;
+            if (!number(out[i])) return false;
+        }
+        return expect(']', "expected ']' (array too long?)");
+    }
+    bool vec3(glm::vec3& v, bool splat = false) { return floats(&v.x, 3, splat); }
+
+    // '{' "key": value, ... '}': member(key) reads the value and returns false on error.
+    template <class F>
+    bool object(F&& member) {
+        if (!expect('{', "expected '{'")) return false;
+        if (peek('}')) { ++p_; return true; }
+        do {
+            if (!string(key_) || !expect(':', "expected ':'")) return false;
+            std::string key = std::move(key_);
+            if (!member(key)) return fail("bad value");
+            key_ = std::move(key);  // keep the capacity for the next key
+        } while (next('}'));
+        return ok_;
+    }
+
+    // '[' value, ... ']': element() reads one value.
+    template <class F>
+    bool array(F&& element) {
+        if (!expect('[', "expected '['")) return false;
+        if (peek(']')) { ++p_; return true; }
+        do {
+            if (!element()) return fail("bad value");
+        } while (next(']'));
+        return ok_;
+    }
+
+    // Any value, for unknown keys.
+    bool skip() {
+        if (!ok_) return false;
+        ws();
+        if (p_ == end_) return fail("unexpected end of file");
+        switch (*p_) {
+        case '{': return object([&](const std::string&) { return skip(); });
+        case '[': return array([&] { return skip(); });
+        case '"': return string(scratch_);
+        case 't': case 'f': { bool b; return boolean(b); }
+        case 'n':
+            if (end_ - p_ >= 4 && !std::memcmp(p_, "null", 4)) { p_ += 4; return true; }
+            return fail("unexpected token");
+        default: { float f; return number(f); }
+        }
+    }
+
+private:
+    // After a member or element: ',' continues, `close` ends.
+    bool next(char close) {
+        if (!ok_) return false;
+        ws();
+        if (p_ < end_ && *p_ == ',') { ++p_; return true; }
+        if (p_ < end_ && *p_ == close) { ++p_; return false; }
+        fail(close == '}' ? "expected ',' or '}'" : "expected ',' or ']'");
+        return false;
+    }
+
+    const char* begin_;
+    const char* p_;
+    const char* end_;
+    const std::string& file_;
+    bool ok_ = true;
+    std::string key_, scratch_;
+};
+
+bool readInstance(JsonReader& in, InstanceData& inst) {
+    glm::vec3 position(0.0f), rotation(0.0f), scale(1.0f);
+    glm::vec4 material(1.0f);
+    float matrix[16];
+    bool hasMatrix = false;
+    bool ok = in.object([&](const std::string& key) {
+        if (key == "position") return in.vec3(position);
+        if (key == "rotation") return in.vec3(rotation);
+        if (key == "scale") return in.vec3(scale, true);
+        if (key == "matrix") { hasMatrix = true; return in.floats(matrix, 16); }
+        if (key == "color") return in.floats(&material.x, 3);
+        if (key == "shininess") return in.number(material.w);
+        return in.skip();
+    });
+    if (!ok) return false;
+    if (hasMatrix) std::memcpy(&inst.Model[0][0], matrix, sizeof(matrix));
+    else {
+        glm::mat4 m = glm::mat4_cast(glm::quat(glm::radians(rotation)));  // X, then Y, then Z
+        m[0] *= scale.x; m[1] *= scale.y; m[2] *= scale.z;
+        m[3] = glm::vec4(position, 1.0f);
+        inst.Model = m;
+    }
+    inst.Material = material;
+    return true;
+}
+
+bool readModel(JsonReader& in, SceneModelDesc& model) {
+    return in.object([&](const std::string& key) {
+        if (key == "mesh") return in.string(model.mesh);
+        if (key == "normalMap") return in.string(model.normalMap);
+        if (key == "flipNormalY") return in.boolean(model.flipNormalY);
+        if (key == "color") return in.vec3(model.color);
+        if (key == "shininess") return in.number(model.shininess);
+        if (key == "instances") return in.array([&] {
+            model.instances.emplace_back();
+            return readInstance(in, model.instances.back());
+        });
+        return in.skip();
+    });
+}
+
+// Defaults match a light added from the GUI.
+bool readLight(JsonReader& in, LightCPU& L) {
+    std::string type = "point";
+    float inner = 12.5f, outer = 17.5f;
+    bool ok = in.object([&](const std::string& key) {
+        if (key == "type") return in.string(type);
+        if (key == "position") return in.vec3(L.position);
+        if (key == "direction") return in.vec3(L.direction);
+        if (key == "color") return in.vec3(L.color);
+        if (key == "ambient") return in.number(L.ambient);
+        if (key == "diffuse") return in.number(L.diffuse);
+        if (key == "specular") return in.number(L.specular);
+        if (key == "constant") return in.number(L.constant);
+        if (key == "linear") return in.number(L.linear);
+        if (key == "quadratic") return in.number(L.quadratic);
+        if (key == "innerCone") return in.number(inner);
+        if (key == "outerCone") return in.number(outer);
+        if (key == "followCamera") return in.boolean(L.followCamera);
+        if (key == "gizmo") return in.boolean(L.drawGizmo);
+        return in.skip();
+    });
+    if (!ok) return false;
+    if (type == "directional") L.type = LightType::Directional;
+    else if (type == "point") L.type = LightType::Point;
+    else if (type == "spot") L.type = LightType::Spot;
+    else return in.fail("light type must be directional, point or spot");
+    if (glm::dot(L.direction, L.direction) > 0.0f) L.direction = glm::normalize(L.direction);
+    L.innerCutoff = std::cos(glm::radians(inner));
+    L.outerCutoff = std::cos(glm::radians(outer));
+    return true;
+}
+
+bool readCamera(JsonReader& in, SceneCameraDesc& camera) {
+    camera.set = true;
+    return in.object([&](const std::string& key) {
+        if (key == "position") return in.vec3(camera.position);
+        if (key == "target") return in.vec3(camera.target);
+        if (key == "fov") return in.number(camera.fov);
+        return in.skip();
+    });
+}
+
+} // namespace
+
+bool loadSceneFile(const std::string& path, SceneDesc& scene) {
+    auto start = std::chrono::steady_clock::now();
+    scene = SceneDesc();
+    MappedFile file(path);
+    if (!file.valid()) { std::cout << "ERROR::SCENE::OPEN_FAILED: " << path << std::endl; return false; }
+
+    const char* text = (const char*)file.data();
+    JsonReader in(text, text + file.size(), path);
+    size_t droppedLights = 0;
+    bool ok = in.object([&](const std::string& key) {
+        if (key == "camera") return readCamera(in, scene.camera);
+        if (key == "models") return in.array([&] {
+            scene.models.emplace_back();
+            return readModel(in, scene.models.back());
+        });
+        if (key == "lights") {
+            scene.hasLights = true;
+            return in.array([&] {
+                LightCPU L{};
+                if (!readLight(in, L)) return false;
+                if ((int)scene.lights.size() < MAX_CLUSTERED_LIGHTS) scene.lights.push_back(L);
+                else droppedLights++;
+                return true;
+            });
+        }
+        return in.skip();
+    });
+    if (ok && !in.atEnd()) ok = in.fail("trailing characters after the scene object");
+    if (!ok) return false;
+
+    if (droppedLights)
+        std::cout << "WARNING::SCENE::TOO_MANY_LIGHTS: kept the first " << MAX_CLUSTERED_LIGHTS << ", dropped "
+                  << droppedLights << std::endl;
+    std::filesystem::path dir = std::filesystem::path(path).parent_path();
+    auto resolve = [&](std::string& p) {
+        if (!p.empty() && std::filesystem::path(p).is_relative()) p = (dir / p).string();
+    };
+    for (SceneModelDesc& m : scene.models) {
+        if (m.mesh.empty()) { std::cout << "ERROR::SCENE::NO_MESH: a model in " << path << " has no \"mesh\"" << std::endl; return false; }
+        resolve(m.mesh);
+        resolve(m.normalMap);
+        if (m.instances.empty()) m.instances.push_back({ glm::mat4(1.0f), glm::vec4(1.0f) });
+        scene.instanceCount += m.instances.size();
+    }
+    scene.parseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "SCENE::LOADED: " << path << ": " << scene.models.size() << " models, " << scene.instanceCount
+              << " instances, " << scene.lights.size() << " lights in " << scene.parseMs << " ms" << std::endl;
+    return true;
+}
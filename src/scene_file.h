@@ -0,0 +1,41 @@
+#pragma once
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "lighting.h"
+#include "model.h"
+
+// One mesh of a scene file and the copies of it that are drawn.
+struct SceneModelDesc {
+    std::string mesh;                     // resolved against the scene file's directory
+    std::string normalMap;                // empty = vertex normals
+    bool        flipNormalY = false;
+    glm::vec3   color{ 0.8f };            // base albedo; each instance tints it
+    float       shininess = 32.0f;        // each instance scales it
+    std::vector<InstanceData> instances;  // empty in the file = one copy at the origin
+};
+
+struct SceneCameraDesc {
+    bool      set = false;  // "camera" present
+    glm::vec3 position{ 0.0f, 0.0f, 5.0f }, target{ 0.0f };
+    float     fov = 45.0f;  // vertical, degrees
+};
+
+struct SceneDesc {
+    std::vector<SceneModelDesc> models;
+    std::vector<LightCPU> lights;
+    bool   hasLights = false;  // "lights" present: they replace the startup lights
+    SceneCameraDesc camera;
+    size_t instanceCount = 0;
+    double parseMs = 0.0;
+};
+
+// Reads a scene file (JSON; the format is in README.md). One pass over the memory-mapped
+// file with no document tree: values are parsed straight into `scene`. Unknown keys are
+// skipped. On malformed input logs ERROR::SCENE::PARSE with the line and column and returns false.
+bool loadSceneFile(const std::string& path, SceneDesc& scene);
+
+#endif
@@ -2,8 +2,25 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <cstring>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+unsigned long long Shader::s_nameLookups = 0;
+unsigned long long Shader::s_uniformUploads = 0;
+unsigned long long Shader::s_uniformSkips = 0;
+
+// Inserts "#define ..." lines right after the #version directive (which must stay first).
+static std::string injectDefines(const std::string& code, const std::string& defines) {
+    if (defines.empty()) return code;
+    size_t at = 0;
+    if (code.compare(0, 8, "#version") == 0) {
+        size_t eol = code.find('\n');
+        at = (eol == std::string::npos) ? code.size() : eol + 1;
+    }
+    return code.substr(0, at) + defines + code.substr(at);
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines) {
     std::string vertexCode;
     std::string fragmentCode;
     std::ifstream vShaderFile;
@@ -23,8 +40,8 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         vShaderFile.close();
         fShaderFile.close();
 
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        vertexCode = injectDefines(vShaderStream.str(), defines);
+        fragmentCode = injectDefines(fShaderStream.str(), defines);
     }
     catch (std::ifstream::failure& e) {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
@@ -56,34 +73,180 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    reflectUniforms();
+}
+
+// Compute-only program (requires a GL 4.3 context).
+Shader::Shader(const char* computePath) {
+    std::string computeCode;
+    std::ifstream cShaderFile;
+    cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    try {
+        cShaderFile.open(computePath);
+        std::stringstream cShaderStream;
+        cShaderStream << cShaderFile.rdbuf();
+        cShaderFile.close();
+        computeCode = cShaderStream.str();
+    }
+    catch (std::ifstream::failure& e) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+    }
+
+    const char* cShaderCode = computeCode.c_str();
+
+    unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute, 1, &cShaderCode, NULL);
+    glCompileShader(compute);
+    checkCompileErrors(compute, "COMPUTE");
+
+    ID = glCreateProgram();
+    glAttachShader(ID, compute);
+    glLinkProgram(ID);
+    checkCompileErrors(ID, "PROGRAM");
+
+    glDeleteShader(compute);
+
+    reflectUniforms();
+}
+
+// Enumerate active uniforms once so hot-path setters never query locations by name.
+void Shader::reflectUniforms() {
+    uniforms_.clear();
+    shadow_.clear();
+    GLint count = 0, maxLen = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+    std::vector<char> name((size_t)maxLen + 1);
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei len = 0; GLint size = 0; GLenum type = 0;
+        glGetActiveUniform(ID, (GLuint)i, (GLsizei)name.size(), &len, &size, &type, name.data());
+        GLint loc = glGetUniformLocation(ID, name.data());
+        if (loc < 0) continue; // lives in a uniform block
+
+        std::string n(name.data(), (size_t)len);
+        if (n.size() > 3 && n.compare(n.size() - 3, 3, "[0]") == 0) n.resize(n.size() - 3); // "arr[0]" -> "arr"
+        std::uint32_t h = uniformHash(n.c_str());
+        if (!uniforms_.emplace(h, UniformInfo{ loc, type, size }).second)
+            std::cout << "WARNING::SHADER::UNIFORM_HASH_COLLISION: " << n << std::endl;
+        if ((size_t)loc >= shadow_.size()) shadow_.resize((size_t)loc + 1);
+    }
+}
+
+GLint Shader::resolve(std::uint32_t nameHash, GLenum expectedType) const {
+    auto it = uniforms_.find(nameHash);
+    if (it == uniforms_.end()) return -1; // optimized out or misspelled
+    GLenum t = it->second.type;
+    bool ok = (t == expectedType);
+    if (!ok && expectedType == GL_INT) // samplers are set through int handles
+        ok = (t == GL_SAMPLER_2D || t == GL_IMAGE_2D || t == GL_SAMPLER_2D_ARRAY || t == GL_SAMPLER_2D_ARRAY_SHADOW ||
+              t == GL_SAMPLER_BUFFER || t == GL_INT_SAMPLER_BUFFER || t == GL_UNSIGNED_INT_SAMPLER_BUFFER);
+    if (!ok) {
+        std::cout << "WARNING::SHADER::UNIFORM_TYPE_MISMATCH: hash " << nameHash << std::endl;
+        return -1;
+    }
+    return it->second.location;
+}
+
+GLint Shader::lookup(const std::string& name) const {
+    ++s_nameLookups;
+    GLint loc = glGetUniformLocation(ID, name.c_str());
+    invalidateShadow(loc); // written behind the shadow's back
+    return loc;
+}
+
+// Returns true (and records the value) when it differs from the last upload.
+bool Shader::updateShadow(GLint location, const void* data, std::size_t bytes) const {
+    if (location < 0) return false;
+    if ((size_t)location >= shadow_.size()) shadow_.resize((size_t)location + 1);
+    ShadowSlot& slot = shadow_[(size_t)location];
+    if (slot.valid && std::memcmp(slot.value, data, bytes) == 0) { ++s_uniformSkips; return false; }
+    std::memcpy(slot.value, data, bytes);
+    slot.valid = true;
+    ++s_uniformUploads;
+    return true;
+}
+
+void Shader::invalidateShadow(GLint location) const {
+    if (location >= 0 && (size_t)location < shadow_.size()) shadow_[(size_t)location].valid = false;
 }
 
 void Shader::use() {
     glUseProgram(ID);
 }
 
+void Shader::set(Uniform<bool> u, bool value) const {
+    int v = (int)value;
+    if (updateShadow(u.location, &v, sizeof(v))) glUniform1i(u.location, v);
+}
+
+void Shader::set(Uniform<int> u, int value) const {
+    if (updateShadow(u.location, &value, sizeof(value))) glUniform1i(u.location, value);
+}
+
+void Shader::set(Uniform<float> u, float value) const {
+    if (updateShadow(u.location, &value, sizeof(value))) glUniform1f(u.location, value);
+}
+
+void Shader::set(Uniform<glm::vec2> u, const glm::vec2& value) const {
+    if (updateShadow(u.location, &value[0], sizeof(value))) glUniform2fv(u.location, 1, &value[0]);
+}
+
+void Shader::set(Uniform<glm::vec3> u, const glm::vec3& value) const {
+    if (updateShadow(u.location, &value[0], sizeof(value))) glUniform3fv(u.location, 1, &value[0]);
+}
+
+void Shader::set(Uniform<glm::vec4> u, const glm::vec4& value) const {
+    if (updateShadow(u.location, &value[0], sizeof(value))) glUniform4fv(u.location, 1, &value[0]);
+}
+
+void Shader::set(Uniform<glm::ivec2> u, const glm::ivec2& value) const {
+    if (updateShadow(u.location, &value[0], sizeof(value))) glUniform2iv(u.location, 1, &value[0]);
+}
+
+void Shader::set(Uniform<glm::ivec3> u, const glm::ivec3& value) const {
+    if (updateShadow(u.location, &value[0], sizeof(value))) glUniform3iv(u.location, 1, &value[0]);
+}
+
+void Shader::set(Uniform<glm::mat4> u, const glm::mat4& mat) const {
+    if (updateShadow(u.location, &mat[0][0], sizeof(mat))) glUniformMatrix4fv(u.location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void Shader::set(Uniform<glm::mat4> u, const glm::mat4* mats, int count) const {
+    if (u.location < 0) return;
+    for (int i = 0; i < count; ++i) invalidateShadow(u.location + i);
+    ++s_uniformUploads;
+    glUniformMatrix4fv(u.location, count, GL_FALSE, &mats[0][0][0]);
+}
+
 void Shader::setBool(const std::string& name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    glUniform1i(lookup(name), (int)value);
 }
 
 void Shader::setInt(const std::string& name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1i(lookup(name), value);
 }
 
 void Shader::setFloat(const std::string& name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    glUniform1f(lookup(name), value);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(lookup(name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    glUniform3fv(lookup(name), 1, &value[0]);
 }
 
 void Shader::setVec3(const std::string& name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    glUniform3f(lookup(name), x, y, z);
+}
+
+void Shader::bindUniformBlock(const char* blockName, unsigned int binding) const {
+    GLuint idx = glGetUniformBlockIndex(ID, blockName);
+    if (idx != GL_INVALID_INDEX) glUniformBlockBinding(ID, idx, binding);
 }
 
 void Shader::checkCompileErrors(unsigned int shader, std::string type) {
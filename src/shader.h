@@ -4,15 +4,66 @@
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <vector>
+
+// FNV-1a over a uniform name; constexpr so "name"_u folds to a constant at compile time.
+constexpr std::uint32_t uniformHash(const char* s, std::uint32_t h = 2166136261u) {
+    return *s ? uniformHash(s + 1, (h ^ (std::uint32_t)(unsigned char)*s) * 16777619u) : h;
+}
+constexpr std::uint32_t operator"" _u(const char* s, std::size_t) { return uniformHash(s); }
+
+// GL type each C++ uniform type must reflect as.
+template <typename T> struct UniformTraits;
+template <> struct UniformTraits<bool>       { static constexpr GLenum glType = GL_BOOL; };
+template <> struct UniformTraits<int>        { static constexpr GLenum glType = GL_INT; };
+template <> struct UniformTraits<float>      { static constexpr GLenum glType = GL_FLOAT; };
+template <> struct UniformTraits<glm::vec2>  { static constexpr GLenum glType = GL_FLOAT_VEC2; };
+template <> struct UniformTraits<glm::vec3>  { static constexpr GLenum glType = GL_FLOAT_VEC3; };
+template <> struct UniformTraits<glm::vec4>  { static constexpr GLenum glType = GL_FLOAT_VEC4; };
+template <> struct UniformTraits<glm::ivec2> { static constexpr GLenum glType = GL_INT_VEC2; };
+template <> struct UniformTraits<glm::ivec3> { static constexpr GLenum glType = GL_INT_VEC3; };
+template <> struct UniformTraits<glm::mat4>  { static constexpr GLenum glType = GL_FLOAT_MAT4; };
+
+// Pre-resolved uniform location; setting an invalid handle is a silent no-op, like location -1.
+template <typename T>
+struct Uniform {
+    GLint location = -1;
+    bool valid() const { return location >= 0; }
+};
 
 class Shader {
 public:
     unsigned int ID;
 
-    Shader(const char* vertexPath, const char* fragmentPath);
+    // defines: extra "#define NAME VALUE\n" lines injected after #version in both stages.
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "");
+    explicit Shader(const char* computePath);
     void use();
 
+    // Typed handle from the reflection table built after linking (no driver call).
+    template <typename T>
+    Uniform<T> uniform(std::uint32_t nameHash) const {
+        return Uniform<T>{ resolve(nameHash, UniformTraits<T>::glType) };
+    }
+
+    // Typed setters compare against the last value uploaded to this program and skip
+    // the GL call when nothing changed.
+    void set(Uniform<bool> u, bool value) const;
+    void set(Uniform<int> u, int value) const;
+    void set(Uniform<float> u, float value) const;
+    void set(Uniform<glm::vec2> u, const glm::vec2& value) const;
+    void set(Uniform<glm::vec3> u, const glm::vec3& value) const;
+    void set(Uniform<glm::vec4> u, const glm::vec4& value) const;
+    void set(Uniform<glm::ivec2> u, const glm::ivec2& value) const;
+    void set(Uniform<glm::ivec3> u, const glm::ivec3& value) const;
+    void set(Uniform<glm::mat4> u, const glm::mat4& mat) const;
+    // Whole mat4[] array from its first element's handle; always uploads.
+    void set(Uniform<glm::mat4> u, const glm::mat4* mats, int count) const;
+
+    // By-name setters: each call goes through glGetUniformLocation and bumps nameLookups().
     void setBool(const std::string& name, bool value) const;
     void setInt(const std::string& name, int value) const;
     void setFloat(const std::string& name, float value) const;
@@ -20,8 +71,41 @@ public:
     void setVec3(const std::string& name, const glm::vec3& value) const;
     void setVec3(const std::string& name, float x, float y, float z) const;
 
+    // Binds a named uniform block to a buffer binding point (no-op if the block is absent).
+    void bindUniformBlock(const char* blockName, unsigned int binding) const;
+
+    // Total by-name uniform lookups across all shaders since startup.
+    static unsigned long long nameLookups() { return s_nameLookups; }
+    // Typed-setter calls that reached the driver / were dropped as redundant, since startup.
+    static unsigned long long uniformUploads() { return s_uniformUploads; }
+    static unsigned long long uniformSkips() { return s_uniformSkips; }
+
 private:
+    struct UniformInfo {
+        GLint  location;
+        GLenum type;
+        GLint  size;
+    };
+
+    // Shadow copy of the last value uploaded per location (mat4 is the largest type).
+    struct ShadowSlot {
+        float value[16];
+        bool  valid = false;
+    };
+
+    std::unordered_map<std::uint32_t, UniformInfo> uniforms_;
+    mutable std::vector<ShadowSlot> shadow_;
+    static unsigned long long s_nameLookups;
+    static unsigned long long s_uniformUploads;
+    static unsigned long long s_uniformSkips;
+
+    bool updateShadow(GLint location, const void* data, std::size_t bytes) const;
+    void invalidateShadow(GLint location) const;
+
+    void reflectUniforms();
+    GLint resolve(std::uint32_t nameHash, GLenum expectedType) const;
+    GLint lookup(const std::string& name) const;
     void checkCompileErrors(unsigned int shader, std::string type);
 };
 
-#endif
\ No newline at end of file
+#endif
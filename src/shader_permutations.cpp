@@ -0,0 +1,27 @@
+#include "shader_permutations.h"
+
+// bit 0..2 flags, then 4 bits per light count (counts never exceed MAX_LIGHTS = 8), bit 15 shadows, bit 16 instanced
+std::uint32_t ShaderFeatures::key() const {
+    std::uint32_t k = (normalMap ? 1u : 0u) | (flipY && normalMap ? 2u : 0u) | (clustered ? 4u : 0u);
+    if (!clustered)
+        k |= ((std::uint32_t)numDir << 3) | ((std::uint32_t)numPoint << 7) | ((std::uint32_t)numSpot << 11);
+    if (shadows) k |= 1u << 15;
+    if (instanced) k |= 1u << 16;
+    return k;
+}
+
+std::string ShaderFeatures::defines() const {
+    std::string d;
+    if (normalMap) d += "#define NORMAL_MAP\n";
+    if (normalMap && flipY) d += "#define FLIP_Y\n";
+    if (shadows) d += "#define SHADOWS\n";
+    if (instanced) d += "#define INSTANCED\n";
+    if (clustered) {
+        d += "#define CLUSTERED\n";
+    } else {
+        d += "#define NUM_DIR_LIGHTS " + std::to_string(numDir) + "\n";
+        d += "#define NUM_POINT_LIGHTS " + std::to_string(numPoint) + "\n";
+        d += "#define NUM_SPOT_LIGHTS " + std::to_string(numSpot) + "\n";
+    }
+    return d;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "shader.h"
+
+// Feature set that selects a compile-time specialization of the lighting shaders.
+struct ShaderFeatures {
+    bool normalMap = false;   // NORMAL_MAP
+    bool flipY = false;       // FLIP_Y
+    bool clustered = false;   // CLUSTERED
+    bool shadows = false;     // SHADOWS (cascaded shadow map for the first directional light)
+    bool instanced = false;   // INSTANCED (per-instance transform + material attributes)
+    // Forward path light counts per type (NUM_DIR/POINT/SPOT_LIGHTS); ignored when clustered.
+    int  numDir = 0, numPoint = 0, numSpot = 0;
+
+    std::uint32_t key() const;
+    std::string defines() const;
+};
+
+// Cache of program variants compiled on demand from one vertex/fragment source pair.
+// Bindings is a per-variant struct with `void init(Shader&)` that resolves uniform
+// handles and sets one-time state right after the variant is linked.
+template <typename Bindings>
+class ShaderPermutations {
+public:
+    struct Variant {
+        std::uint32_t           key;
+        std::string             defines;
+        double                  compileMs;
+        std::unique_ptr<Shader> shader;
+        Bindings                bindings;
+    };
+
+    ShaderPermutations(const char* vertexPath, const char* fragmentPath)
+        : vertexPath_(vertexPath), fragmentPath_(fragmentPath) {}
+
+    Variant& get(const ShaderFeatures& features) {
+        std::uint32_t key = features.key();
+        auto it = cache_.find(key);
+        if (it != cache_.end()) return *it->second;
+
+        auto v = std::make_unique<Variant>();
+        v->key = key;
+        v->defines = features.defines();
+        auto t0 = std::chrono::high_resolution_clock::now();
+        v->shader = std::make_unique<Shader>(vertexPath_, fragmentPath_, v->defines);
+        v->compileMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+        v->bindings.init(*v->shader);
+
+        Variant& ref = *v;
+        order_.push_back(&ref);
+        cache_.emplace(key, std::move(v));
+        return ref;
+    }
+
+    // Compiled variants in compile order.
+    const std::vector<Variant*>& compiled() const { return order_; }
+    const char* fragmentPath() const { return fragmentPath_; }
+
+private:
+    const char* vertexPath_;
+    const char* fragmentPath_;
+    std::unordered_map<std::uint32_t, std::unique_ptr<Variant>> cache_;
+    std::vector<Variant*> order_;
+};
+
+#endif
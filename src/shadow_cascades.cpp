@@ -0,0 +1,123 @@
+#include "shadow_cascades.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+// Shadows stop at this view depth; the split scheme blends uniform and logarithmic.
+static const float SHADOW_DISTANCE = 30.0f;
+static const float SPLIT_LAMBDA = 0.75f;
+// Maps cover the slice's bounding sphere plus this fraction, so the slice can move
+// that far before the cascade has to be re-rendered.
+static const float CACHE_MARGIN = 0.15f;
+// How far behind a slice (towards the light) casters are still captured.
+static const float CASTER_EXTENT = 20.0f;
+
+void ShadowCascades::init() {
+    glGenTextures(1, &depthArray_);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray_);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, RESOLUTION, RESOLUTION, CASCADES, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &fbo_);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    for (auto& m : lightSpace_) m = glm::mat4(1.0f);
+}
+
+void ShadowCascades::invalidate() {
+    for (auto& c : cache_) c.valid = false;
+}
+
+int ShadowCascades::update(const LightCPU& light, const glm::mat4& casterModel, const glm::mat4& view,
+                           float fovYRad, float aspect, float zNear, const DrawCasters& drawCasters) {
+    const glm::vec3 dir = glm::normalize(light.direction);
+    const glm::vec3 up = std::fabs(dir.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+    const glm::mat4 lightRot = glm::lookAt(glm::vec3(0.0f), dir, up);
+    const glm::mat4 invView = glm::inverse(view);
+    const float tanY = std::tan(fovYRad * 0.5f), tanX = tanY * aspect;
+
+    GLint prevFbo = 0, prevViewport[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+    glGetIntegerv(GL_VIEWPORT, prevViewport);
+
+    int rendered = 0;
+    float sliceNear = zNear;
+    for (int c = 0; c < CASCADES; ++c) {
+        float p = (float)(c + 1) / CASCADES;
+        float sliceFar = SPLIT_LAMBDA * zNear * std::pow(SHADOW_DISTANCE / zNear, p)
+                       + (1.0f - SPLIT_LAMBDA) * (zNear + (SHADOW_DISTANCE - zNear) * p);
+        splits_[c] = sliceFar;
+
+        // bounding sphere of the slice's 8 world-space corners
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int k = 0; k < 8; ++k) {
+            float d = (k & 4) ? sliceFar : sliceNear;
+            glm::vec3 v((k & 1 ? 1.0f : -1.0f) * d * tanX, (k & 2 ? 1.0f : -1.0f) * d * tanY, -d);
+            corners[k] = glm::vec3(invView * glm::vec4(v, 1.0f));
+            center += corners[k] * 0.125f;
+        }
+        float radius = 0.0f;
+        for (const auto& k : corners) radius = std::max(radius, glm::length(k - center));
+        radius = std::ceil(radius * 16.0f) / 16.0f;  // keep the extent stable across frames
+        sliceNear = sliceFar;
+
+        Cache& cc = cache_[c];
+        bool stale = !cc.valid || cc.lightDir != dir || cc.model != casterModel ||
+                     glm::length(center - cc.center) + radius > cc.halfExtent;
+        if (!stale) continue;
+
+        // snap the center to whole texels in light space so re-renders don't shimmer
+        float halfExtent = radius * (1.0f + CACHE_MARGIN);
+        float texel = 2.0f * halfExtent / RESOLUTION;
+        glm::vec3 ls = glm::vec3(lightRot * glm::vec4(center, 1.0f));
+        ls.x = std::floor(ls.x / texel) * texel;
+        ls.y = std::floor(ls.y / texel) * texel;
+        glm::vec3 snapped = glm::vec3(glm::inverse(lightRot) * glm::vec4(ls, 1.0f));
+
+        float back = halfExtent + CASTER_EXTENT;
+        glm::mat4 lightView = glm::lookAt(snapped - dir * back, snapped, up);
+        glm::mat4 lightProj = glm::ortho(-halfExtent, halfExtent, -halfExtent, halfExtent, 0.0f, back + halfExtent);
+        lightSpace_[c] = lightProj * lightView;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo_);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray_, 0, c);
+        glViewport(0, 0, RESOLUTION, RESOLUTION);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(2.0f, 4.0f);
+        drawCasters(lightView, lightProj);
+        glDisable(GL_POLYGON_OFFSET_FILL);
+
+        cc.valid = true;
+        cc.lightDir = dir;
+        cc.model = casterModel;
+        cc.center = snapped;
+        cc.halfExtent = halfExtent;
+        ++rendered;
+    }
+
+    if (rendered) {
+        glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)prevFbo);
+        glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+    }
+    totalRenders_ += (unsigned long long)rendered;
+    cachedLastUpdate_ = CASCADES - rendered;
+    return rendered;
+}
+
+void ShadowCascades::bind() const {
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray_);
+    glActiveTexture(GL_TEXTURE0);
+}
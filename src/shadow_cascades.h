@@ -0,0 +1,55 @@
+#pragma once
+#ifndef SHADOW_CASCADES_H
+#define SHADOW_CASCADES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <functional>
+#include "lighting.h"
+
+// Cascaded shadow maps for the first directional light, cached across frames.
+// A cascade is re-rendered only when the light direction or the caster transform
+// changes, or when its frustum slice drifts out of the margin the cached map was
+// rendered with; otherwise last frame's depth layer (and its matrix) are reused.
+class ShadowCascades {
+public:
+    static const int CASCADES = 3;            // must match SHADOW_CASCADES in the shaders
+    static const int RESOLUTION = 1024;
+    static const int TEXTURE_UNIT = 4;
+
+    // Draws all shadow casters with the given depth program already bound.
+    using DrawCasters = std::function<void(const glm::mat4& lightView, const glm::mat4& lightProj)>;
+
+    void init();
+    // Refreshes stale cascades for the current camera; returns the number re-rendered.
+    int update(const LightCPU& light, const glm::mat4& casterModel, const glm::mat4& view,
+               float fovYRad, float aspect, float zNear, const DrawCasters& drawCasters);
+    // Forces every cascade to re-render (e.g. after the caster geometry changed).
+    void invalidate();
+    void bind() const;
+
+    const glm::mat4* lightSpace() const { return lightSpace_; }
+    // View-space depth at the far end of each cascade (w unused).
+    glm::vec4 splits() const { return splits_; }
+
+    unsigned long long totalRenders() const { return totalRenders_; }
+    int cachedCascades() const { return cachedLastUpdate_; }
+
+private:
+    struct Cache {
+        bool      valid = false;
+        glm::vec3 lightDir{ 0.0f };
+        glm::mat4 model{ 1.0f };
+        glm::vec3 center{ 0.0f };   // texel-snapped sphere center the map was rendered around
+        float     halfExtent = 0.0f;
+    };
+
+    GLuint depthArray_ = 0, fbo_ = 0;
+    Cache  cache_[CASCADES];
+    glm::mat4 lightSpace_[CASCADES];
+    glm::vec4 splits_{ 0.0f };
+    unsigned long long totalRenders_ = 0;
+    int cachedLastUpdate_ = 0;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#include "texture_cache.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<CookedTextureHeader>::value, "CookedTextureHeader is written as raw bytes");
+
+std::string textureCacheFile(std::uint64_t sourceHash, std::uint64_t settingsHash){
+    char name[64];
+    std::snprintf(name,sizeof(name),"%016llx-%016llx.tex",(unsigned long long)sourceHash,(unsigned long long)settingsHash);
+    return std::string(TEXTURE_CACHE_DIR)+"/"+name;
+}
+
+bool writeCookedTexture(const std::string& file, const CookedTextureHeader& header, const void* data, size_t dataBytes){
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(file).parent_path(),ec);
+    std::string tmp=file+".tmp";
+    {
+        std::ofstream out(tmp,std::ios::binary|std::ios::trunc);
+        out.write((const char*)&header,sizeof(header));
+        static const char zeros[16]={};
+        out.write(zeros,(std::streamsize)(header.dataOffset-sizeof(header)));
+        out.write((const char*)data,(std::streamsize)dataBytes);
+        if(!out){ std::cout<<"ERROR::TEXTURE_CACHE::WRITE_FAILED: "<<tmp<<std::endl; return false; }
+    }
+    std::filesystem::rename(tmp,file,ec);
+    if(ec){ std::cout<<"ERROR::TEXTURE_CACHE::WRITE_FAILED: "<<file<<" ("<<ec.message()<<")"<<std::endl; std::filesystem::remove(tmp,ec); return false; }
+    return true;
+}
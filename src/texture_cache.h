@@ -0,0 +1,42 @@
+#pragma once
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+// Cooked textures, stored under TEXTURE_CACHE_DIR as <key>.tex so a repeat load skips the
+// image decode, the mip filter and compression. Layout: CookedTextureHeader, then every mip
+// level, finest first, exactly as uploaded (texel rows, or BC5 block rows), each level
+// starting on a 16-byte boundary.
+static const char* const TEXTURE_CACHE_DIR = "cache/textures";
+static const std::uint32_t TEXTURE_CACHE_VERSION = 1;
+static const int MAX_TEXTURE_LEVELS = 16;    // up to 32768x32768
+
+struct CookedTextureLevel {
+    std::uint32_t width, height, rows, pad;  // a row is one texel row or one row of 4x4 blocks
+    std::uint64_t offset, rowBytes;          // offset from dataOffset
+};
+
+struct CookedTextureHeader {
+    char          magic[8];          // "8PTEX"
+    std::uint32_t version;
+    std::uint32_t headerBytes;       // sizeof(CookedTextureHeader), catches layout changes between builds
+    std::uint64_t sourceHash, settingsHash;
+    std::uint32_t internalFormat, format, levelCount, compressed;
+    std::uint64_t rawBytes;          // the chain as decoded, before compression
+    std::uint64_t dataOffset, dataBytes;
+    CookedTextureLevel levels[MAX_TEXTURE_LEVELS];
+};
+
+// Level data starts here, after the header.
+inline std::uint64_t cookedTextureDataOffset(){ return (sizeof(CookedTextureHeader)+15)&~(std::uint64_t)15; }
+
+// Cache file for a source content hash and cook settings hash.
+std::string textureCacheFile(std::uint64_t sourceHash, std::uint64_t settingsHash);
+
+// Writes header and level data to a temporary file, then renames it into place.
+// Returns false (and logs) on failure.
+bool writeCookedTexture(const std::string& file, const CookedTextureHeader& header, const void* data, size_t dataBytes);
+
+#endif
@@ -0,0 +1,71 @@
+#include "texture_compress.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define TEXTURE_COMPRESS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+static const size_t BC5_MIN_ROWS_PER_THREAD=16;
+
+// Step k (0..7) from max towards min -> BC4 code in the red0 > red1 (8-value) mode.
+static const unsigned char BC4_CODE[8]={0,2,3,4,5,6,7,1};
+
+// 16 texels of one channel -> one BC4 block. Step k is the nearest of max - k*range/7,
+// i.e. the number of thresholds (2j+1)*range/14 that 14*(max-v) exceeds; exact in 16 bits.
+static void encodeBC4(const unsigned char v[16], unsigned char* out){
+    unsigned char steps[16];
+    int lo, hi;
+#ifdef TEXTURE_COMPRESS_SSE2
+    __m128i x=_mm_loadu_si128((const __m128i*)v);
+    __m128i mn=_mm_min_epu8(x,_mm_srli_si128(x,8)), mx=_mm_max_epu8(x,_mm_srli_si128(x,8));
+    mn=_mm_min_epu8(mn,_mm_srli_si128(mn,4)); mx=_mm_max_epu8(mx,_mm_srli_si128(mx,4));
+    mn=_mm_min_epu8(mn,_mm_srli_si128(mn,2)); mx=_mm_max_epu8(mx,_mm_srli_si128(mx,2));
+    mn=_mm_min_epu8(mn,_mm_srli_si128(mn,1)); mx=_mm_max_epu8(mx,_mm_srli_si128(mx,1));
+    lo=_mm_cvtsi128_si32(mn)&255; hi=_mm_cvtsi128_si32(mx)&255;
+    const __m128i zero=_mm_setzero_si128(), top=_mm_set1_epi16((short)hi), fourteen=_mm_set1_epi16(14);
+    __m128i d0=_mm_mullo_epi16(_mm_sub_epi16(top,_mm_unpacklo_epi8(x,zero)),fourteen);
+    __m128i d1=_mm_mullo_epi16(_mm_sub_epi16(top,_mm_unpackhi_epi8(x,zero)),fourteen);
+    __m128i k0=zero, k1=zero;
+    for(int j=0;j<7;j++){
+        __m128i t=_mm_set1_epi16((short)((2*j+1)*(hi-lo)));
+        k0=_mm_sub_epi16(k0,_mm_cmpgt_epi16(d0,t)); k1=_mm_sub_epi16(k1,_mm_cmpgt_epi16(d1,t));
+    }
+    _mm_storeu_si128((__m128i*)steps,_mm_packus_epi16(k0,k1));
+#else
+    lo=*std::min_element(v,v+16); hi=*std::max_element(v,v+16);
+    for(int i=0;i<16;i++){
+        int d=14*(hi-v[i]), k=0;
+        for(int j=0;j<7;j++) k+=d>(2*j+1)*(hi-lo);
+        steps[i]=(unsigned char)k;
+    }
+#endif
+    out[0]=(unsigned char)hi; out[1]=(unsigned char)lo;  // equal endpoints: every code 0 decodes to hi
+    std::uint64_t bits=0;
+    for(int i=0;i<16;i++) bits|=(std::uint64_t)BC4_CODE[steps[i]]<<(3*i);
+    for(int b=0;b<6;b++) out[2+b]=(unsigned char)(bits>>(8*b));
+}
+
+void encodeBC5(const unsigned char* pixels, int width, int height, int channels, unsigned char* blocks, unsigned threads){
+    const int bw=(width+3)/4, bh=(height+3)/4;
+    if(!threads) threads=std::max(1u,std::thread::hardware_concurrency());
+    threads=(unsigned)std::max<size_t>(1,std::min<size_t>(threads,bh/BC5_MIN_ROWS_PER_THREAD));
+    parallelFor(threads,[&](unsigned t){
+        unsigned char r[16], g[16];
+        for(int by=bh*t/threads;by<bh*(int)(t+1)/(int)threads;by++){
+            unsigned char* out=blocks+(size_t)by*bw*BC5_BLOCK_BYTES;
+            for(int bx=0;bx<bw;bx++,out+=BC5_BLOCK_BYTES){
+                for(int i=0;i<16;i++){
+                    int x=std::min(bx*4+(i&3),width-1), y=std::min(by*4+(i>>2),height-1);
+                    const unsigned char* p=pixels+((size_t)y*width+x)*channels;
+                    r[i]=p[0]; g[i]=p[1];
+                }
+                encodeBC4(r,out); encodeBC4(g,out+8);
+            }
+        }
+    });
+}
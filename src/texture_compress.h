@@ -0,0 +1,20 @@
+#pragma once
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include <cstddef>
+
+// BC5 (RGTC2, GL_COMPRESSED_RG_RGTC2): two BC4 blocks of 8 bytes, R then G, per 4x4 texels.
+// Normal maps keep X and Y at 4x less memory than RGBA8; the shaders rebuild Z.
+static const size_t BC5_BLOCK_BYTES=16;
+inline size_t bc5RowBytes(int width){ return (size_t)((width+3)/4)*BC5_BLOCK_BYTES; }
+inline size_t bc5Size(int width, int height){ return bc5RowBytes(width)*((height+3)/4); }
+
+// Encodes the first two channels of an 8-bit image with `channels` (>= 2) per texel into
+// row-major BC5 blocks (room for bc5Size). Each BC4 half takes the block's min and max as
+// endpoints and snaps texels to the nearest of the 8 interpolated values, 16 at a time with
+// SSE2 where available. Edge blocks repeat the last row/column. Block rows are split over
+// up to `threads` threads (0 = hardware concurrency).
+void encodeBC5(const unsigned char* pixels, int width, int height, int channels, unsigned char* blocks, unsigned threads=0);
+
+#endif
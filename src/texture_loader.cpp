@@ -0,0 +1,497 @@
+#include "texture_loader.h"
+#include "content_hash.h"
+#include "mapped_file.h"
+#include "texture_cache.h"
+#include "texture_compress.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+// 2x2 box filter; odd edges repeat their last row/column.
+static void downsample(const unsigned char* src, int sw, int sh, unsigned char* dst, int dw, int dh, int n) {
+    for (int y = 0; y < dh; ++y) {
+        const unsigned char* r0 = src + (size_t)std::min(2 * y, sh - 1) * sw * n;
+        const unsigned char* r1 = src + (size_t)std::min(2 * y + 1, sh - 1) * sw * n;
+        for (int x = 0; x < dw; ++x) {
+            int x0 = std::min(2 * x, sw - 1) * n, x1 = std::min(2 * x + 1, sw - 1) * n;
+            for (int c = 0; c < n; ++c)
+                *dst++ = (unsigned char)((r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) >> 2);
+        }
+    }
+}
+
+// Normal-map version: averages the 2x2 unit vectors (Z rebuilt when only XY are stored),
+// renormalizes and re-encodes, so coarse levels stay unit length instead of shortening
+// where the normals diverge. A 4th channel is box-filtered.
+static void downsampleNormals(const unsigned char* src, int sw, int sh, unsigned char* dst, int dw, int dh, int n) {
+    for (int y = 0; y < dh; ++y) {
+        for (int x = 0; x < dw; ++x, dst += n) {
+            float v[3] = { 0.0f, 0.0f, 0.0f };
+            int alpha = 2;
+            for (int i = 0; i < 4; ++i) {
+                const unsigned char* p = src + ((size_t)std::min(2 * y + (i >> 1), sh - 1) * sw + std::min(2 * x + (i & 1), sw - 1)) * n;
+                float nx = p[0] / 127.5f - 1.0f, ny = p[1] / 127.5f - 1.0f;
+                v[0] += nx; v[1] += ny;
+                v[2] += n >= 3 ? p[2] / 127.5f - 1.0f : std::sqrt(std::max(1.0f - nx * nx - ny * ny, 0.0f));
+                if (n == 4) alpha += p[3];
+            }
+            float len = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+            float inv = len > 0.0f ? 1.0f / len : 0.0f;
+            for (int c = 0; c < std::min(n, 3); ++c)
+                dst[c] = (unsigned char)std::lround(std::min(std::max(v[c] * inv, -1.0f), 1.0f) * 127.5f + 127.5f);
+            if (n == 4) dst[3] = (unsigned char)(alpha >> 2);
+        }
+    }
+}
+
+// Only stops the workers: a global loader outlives the GL context, which frees the textures.
+TextureLoader::~TextureLoader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& w : workers_) w.join();
+}
+
+void TextureLoader::startWorkers(unsigned threads) {
+    if (!threads) threads = std::max(std::thread::hardware_concurrency(), 2u) - 1;  // leave the render thread a core
+    for (unsigned i = 0; i < threads; ++i) workers_.emplace_back(&TextureLoader::workerLoop, this);
+}
+
+void TextureLoader::workerLoop() {
+    for (;;) {
+        std::shared_ptr<Texture> t;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            t = queue_.front();
+            queue_.pop_front();
+        }
+        decode(*t);
+        t->decoded = true;  // publishes levels/pixels to the render thread
+    }
+}
+
+GLuint TextureLoader::load(const std::string& path, bool normalMap, unsigned threads) {
+    if (workers_.empty()) startWorkers(threads);
+    std::shared_ptr<Texture> t = std::make_shared<Texture>();
+    glGenTextures(1, &t->tex);
+    t->path = path;
+    t->normalMap = normalMap;
+    textures_.push_back(t);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(t);
+    }
+    wake_.notify_one();
+    return t->tex;
+}
+
+// Worker thread: a cache hit maps the cooked file; otherwise the source is decoded and cooked,
+// then written back to the cache. Leaves `levels` empty on failure.
+void TextureLoader::decode(Texture& t) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+    MappedFile source(t.path);
+    if (!source.valid()) { std::cout << "ERROR::TEXTURE_LOADER::OPEN: " << t.path << std::endl; return; }
+    // keyed by the source bytes and by everything that changes the cooked result
+    const std::uint64_t sourceHash = hashBytes(source.data(), source.size());
+    const std::uint64_t settings[] = { TEXTURE_CACHE_VERSION, t.normalMap, sizeof(CookedTextureHeader) };
+    const std::uint64_t settingsHash = hashBytes(settings, sizeof(settings));
+    t.cacheFile = textureCacheFile(sourceHash, settingsHash);
+    t.cacheHit = loadCooked(t, sourceHash, settingsHash);
+    if (!t.cacheHit) {
+        if (!cook(t, source.data(), source.size())) return;
+        if (saveCooked(t, sourceHash, settingsHash)) {
+            // stream (and re-stream evicted levels) from the page cache rather than a private copy
+            auto mapped = std::make_unique<MappedFile>(t.cacheFile);
+            if (mapped->valid() && mapped->size() >= cookedTextureDataOffset() + t.pixels.size()) {
+                t.data = mapped->data() + cookedTextureDataOffset();
+                t.file = std::move(mapped);
+                std::vector<unsigned char>().swap(t.pixels);
+            }
+        }
+    }
+    t.loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+}
+
+// Decodes the image and builds the full mip chain, finest level first (levels 16-byte
+// aligned, as the cache stores them), then compresses normal maps to BC5 level by level.
+bool TextureLoader::cook(Texture& t, const unsigned char* source, size_t sourceBytes) {
+    int w, h, n;
+    stbi_uc* image = stbi_load_from_memory(source, (int)sourceBytes, &w, &h, &n, 0);
+    if (!image) { std::cout << "ERROR::TEXTURE_LOADER::DECODE: " << t.path << " (" << stbi_failure_reason() << ")" << std::endl; return false; }
+    static const GLenum internalFormats[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+    static const GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+    t.internalFormat = internalFormats[n - 1];
+    t.format = formats[n - 1];
+    const bool normals = t.normalMap && n >= 2;
+
+    size_t total = 0;
+    for (int lw = w, lh = h;; lw = std::max(lw / 2, 1), lh = std::max(lh / 2, 1)) {
+        t.levels.push_back({ lw, lh, total, (size_t)lw * n, lh });
+        t.rawBytes += (size_t)lw * lh * n;
+        total = (total + (size_t)lw * lh * n + 15) & ~(size_t)15;
+        if (lw == 1 && lh == 1) break;
+    }
+    t.pixels.resize(total);
+    std::memcpy(t.pixels.data(), image, (size_t)w * h * n);
+    stbi_image_free(image);
+    for (size_t l = 1; l < t.levels.size(); ++l) {
+        const Level& src = t.levels[l - 1];
+        const Level& dst = t.levels[l];
+        (normals ? downsampleNormals : downsample)(&t.pixels[src.offset], src.width, src.height, &t.pixels[dst.offset], dst.width, dst.height, n);
+    }
+
+    if (normals) {
+        size_t bytes = 0;
+        for (const Level& l : t.levels) bytes += bc5Size(l.width, l.height);
+        std::vector<unsigned char> blocks(bytes);
+        bytes = 0;
+        for (Level& l : t.levels) {
+            encodeBC5(&t.pixels[l.offset], l.width, l.height, n, &blocks[bytes], 1);  // the pool already runs textures in parallel
+            l = { l.width, l.height, bytes, bc5RowBytes(l.width), (l.height + 3) / 4 };
+            bytes += bc5Size(l.width, l.height);
+        }
+        t.pixels.swap(blocks);
+        t.compressed = true;
+        t.internalFormat = GL_COMPRESSED_RG_RGTC2;
+        t.format = GL_RG;
+    }
+    t.data = t.pixels.data();
+    return true;
+}
+
+// A hit keeps the mapping and streams straight from it; any mismatch is treated as a miss.
+bool TextureLoader::loadCooked(Texture& t, std::uint64_t sourceHash, std::uint64_t settingsHash) {
+    auto mapped = std::make_unique<MappedFile>(t.cacheFile);
+    const MappedFile& f = *mapped;
+    CookedTextureHeader h;
+    if (!f.valid() || f.size() < sizeof(h)) return false;
+    std::memcpy(&h, f.data(), sizeof(h));
+    if (std::memcmp(h.magic, "8PTEX", 5) != 0 || h.version != TEXTURE_CACHE_VERSION || h.headerBytes != sizeof(h)
+        || h.sourceHash != sourceHash || h.settingsHash != settingsHash) return false;
+    bool corrupt = h.levelCount < 1 || h.levelCount > (std::uint32_t)MAX_TEXTURE_LEVELS || h.dataOffset + h.dataBytes > f.size();
+    for (std::uint32_t l = 0; l < h.levelCount && !corrupt; ++l)
+        corrupt = h.levels[l].offset + h.levels[l].rowBytes * h.levels[l].rows > h.dataBytes || !h.levels[l].rowBytes;
+    if (corrupt) { std::cout << "ERROR::TEXTURE_CACHE::CORRUPT: " << t.cacheFile << std::endl; return false; }
+    for (std::uint32_t l = 0; l < h.levelCount; ++l) {
+        const CookedTextureLevel& c = h.levels[l];
+        t.levels.push_back({ (int)c.width, (int)c.height, (size_t)c.offset, (size_t)c.rowBytes, (int)c.rows });
+    }
+    t.internalFormat = h.internalFormat;
+    t.format = h.format;
+    t.compressed = h.compressed != 0;
+    t.rawBytes = (size_t)h.rawBytes;
+    t.data = f.data() + h.dataOffset;
+    t.file = std::move(mapped);  // kept for streaming and re-streaming
+    return true;
+}
+
+bool TextureLoader::saveCooked(const Texture& t, std::uint64_t sourceHash, std::uint64_t settingsHash) {
+    if (t.levels.size() > (size_t)MAX_TEXTURE_LEVELS) return false;
+    CookedTextureHeader h{};
+    std::memcpy(h.magic, "8PTEX", 5);
+    h.version = TEXTURE_CACHE_VERSION; h.headerBytes = sizeof(h);
+    h.sourceHash = sourceHash; h.settingsHash = settingsHash;
+    h.internalFormat = t.internalFormat; h.format = t.format;
+    h.levelCount = (std::uint32_t)t.levels.size(); h.compressed = t.compressed;
+    h.rawBytes = t.rawBytes;
+    for (size_t l = 0; l < t.levels.size(); ++l) {
+        const Level& v = t.levels[l];
+        h.levels[l] = { (std::uint32_t)v.width, (std::uint32_t)v.height, (std::uint32_t)v.rows, 0, v.offset, v.rowBytes };
+    }
+    h.dataOffset = cookedTextureDataOffset();
+    h.dataBytes = t.pixels.size();
+    return writeCookedTexture(t.cacheFile, h, t.pixels.data(), t.pixels.size());
+}
+
+// Storage is allocated level by level as each one starts streaming (see upload()), so levels
+// can later be freed on their own; BASE_LEVEL past MAX_LEVEL keeps the texture incomplete
+// until the first (coarsest) level lands.
+void TextureLoader::adopt(Texture& t) {
+    if (t.levels.empty()) {
+        glDeleteTextures(1, &t.tex);
+        t.state = State::Failed;
+        return;
+    }
+    const int levels = (int)t.levels.size();
+    glBindTexture(GL_TEXTURE_2D, t.tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    t.tail = levels - 1;
+    while (t.tail > 0 && std::max(t.levels[t.tail - 1].width, t.levels[t.tail - 1].height) <= TAIL_SIZE) --t.tail;
+    t.resident = -1;
+    t.nextRow = 0;
+    t.state = State::Streaming;
+}
+
+// One texel of level L covers 2^L texels of level 0; the finest level needed is the one
+// with about a texel per pixel. Never coarser than the tail, which always streams.
+int TextureLoader::Texture::wanted() const {
+    if (footprint <= 0.0f) return tail;
+    float texelsPerPixel = std::max(levels[0].width, levels[0].height) / footprint;
+    return std::min(std::max((int)std::floor(std::log2(std::max(texelsPerPixel, 1.0f))), 0), tail);
+}
+
+void TextureLoader::freeLevel(Texture& t, int level) {
+    const Level& l = t.levels[level];
+    glBindTexture(GL_TEXTURE_2D, t.tex);
+    glTexImage2D(GL_TEXTURE_2D, level, t.internalFormat, 0, 0, 0, t.format, GL_UNSIGNED_BYTE, nullptr);
+    t.allocatedBytes -= l.rowBytes * l.rows;
+    residentBytes_ -= l.rowBytes * l.rows;
+}
+
+// Frees the finest allocated level: the one still streaming, else the finest resident one.
+void TextureLoader::evictOne(Texture& t) {
+    if (t.nextRow > 0) {
+        freeLevel(t, t.streamLevel());
+        t.nextRow = 0;
+    } else {
+        glBindTexture(GL_TEXTURE_2D, t.tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, t.resident + 1);
+        freeLevel(t, t.resident);
+        ++t.resident;
+    }
+    ++evictions_;
+}
+
+// Evicts until `bytes` more fit in the budget. A texture drawn this frame only gives up
+// levels finer than it needs; one that was not can drop to its tail. Oldest first.
+bool TextureLoader::makeRoom(size_t bytes) {
+    while (residentBytes_ + bytes > budget_) {
+        Texture* victim = nullptr;
+        for (const std::shared_ptr<Texture>& t : textures_) {
+            if (t->state != State::Streaming || t->plannedFrame == frame_) continue;
+            int keep = t->lastUsed == frame_ ? t->wanted() : t->tail;
+            int finest = t->nextRow > 0 ? t->streamLevel() : t->resident;
+            if (finest < 0 || finest >= keep) continue;
+            if (!victim || t->lastUsed < victim->lastUsed) victim = t.get();
+        }
+        if (!victim) return false;
+        evictOne(*victim);
+    }
+    return true;
+}
+
+// Fills one pixel buffer with row slices of the coarsest levels still wanted, allocating
+// each level (within the budget) as it starts, then issues the copies from the buffer.
+// Skipped for this frame if the buffer's previous copies have not run yet.
+void TextureLoader::upload() {
+    Staging& s = staging_[nextStaging_];
+    if (s.fence) {
+        if (glClientWaitSync(s.fence, 0, 0) == GL_TIMEOUT_EXPIRED) return;
+        glDeleteSync(s.fence);
+        s.fence = nullptr;
+    }
+
+    struct Copy { Texture* t; int level, row, rows; size_t offset; };
+    std::vector<Copy> copies;
+    std::vector<Texture*> blocked;  // over budget with nothing left to evict
+    size_t used = 0;
+    for (;;) {
+        Texture* next = nullptr;
+        size_t nextBytes = 0;
+        for (const std::shared_ptr<Texture>& t : textures_) {
+            if (t->state != State::Streaming || t->streamLevel() < t->wanted()) continue;
+            if (std::find(blocked.begin(), blocked.end(), t.get()) != blocked.end()) continue;
+            const Level& l = t->levels[t->streamLevel()];
+            size_t bytes = l.rowBytes * l.rows;
+            if (!next || bytes < nextBytes) { next = t.get(); nextBytes = bytes; }
+        }
+        if (!next) break;
+        const int level = next->streamLevel();
+        const Level& l = next->levels[level];
+        size_t offset = (used + 3) & ~(size_t)3;
+        int rows = offset < UPLOAD_BYTES_PER_FRAME ? std::min(l.rows - next->nextRow, (int)((UPLOAD_BYTES_PER_FRAME - offset) / l.rowBytes)) : 0;
+        if (rows <= 0) break;
+        next->plannedFrame = frame_;  // not a victim while its own level is being made room for
+        if (next->nextRow == 0) {
+            if (!makeRoom(nextBytes)) { blocked.push_back(next); continue; }
+            glBindTexture(GL_TEXTURE_2D, next->tex);
+            glTexImage2D(GL_TEXTURE_2D, level, next->internalFormat, l.width, l.height, 0, next->format, GL_UNSIGNED_BYTE, nullptr);
+            next->allocatedBytes += nextBytes;
+            residentBytes_ += nextBytes;
+        }
+        copies.push_back({ next, level, next->nextRow, rows, offset });
+        used = offset + rows * l.rowBytes;
+        next->nextRow += rows;
+        if (next->nextRow == l.rows) { next->nextRow = 0; next->resident = level; }  // BASE_LEVEL moves once the copy is issued
+    }
+    blocked_ = blocked.size();
+    if (copies.empty()) return;
+
+    if (!s.buffer) {
+        glGenBuffers(1, &s.buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s.buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, UPLOAD_BYTES_PER_FRAME, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, s.buffer);
+    // the fence above guarantees the GPU is done reading this buffer
+    unsigned char* dst = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)used,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    for (const Copy& c : copies) {
+        const Level& l = c.t->levels[c.level];
+        const unsigned char* src = c.t->data + l.offset + c.row * l.rowBytes;
+        if (dst) std::memcpy(dst + c.offset, src, c.rows * l.rowBytes);
+        else glBufferSubData(GL_PIXEL_UNPACK_BUFFER, (GLintptr)c.offset, (GLsizeiptr)(c.rows * l.rowBytes), src);
+    }
+    if (dst) glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    GLint alignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (const Copy& c : copies) {
+        const Level& l = c.t->levels[c.level];
+        glBindTexture(GL_TEXTURE_2D, c.t->tex);
+        const void* src = (const void*)(uintptr_t)c.offset;
+        if (c.t->compressed)  // block rows; the last one may be cut by the level's height
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, c.level, 0, c.row * 4, l.width, std::min(c.rows * 4, l.height - c.row * 4),
+                c.t->internalFormat, (GLsizei)(c.rows * l.rowBytes), src);
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, c.level, 0, c.row, l.width, c.rows, c.t->format, GL_UNSIGNED_BYTE, src);
+        uploadedBytes_ += c.rows * l.rowBytes;
+        // level complete: later draws sample it (commands run in order, no need to wait)
+        if (c.row + c.rows == l.rows) glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, c.level);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nextStaging_ = (nextStaging_ + 1) % STAGING_BUFFERS;
+}
+
+void TextureLoader::poll() {
+    // frame_ stays the frame whose request()s are being served until the end of the poll
+    if (!pending() && residentBytes_ <= budget_) { ++frame_; return; }
+    auto t0 = std::chrono::high_resolution_clock::now();
+    GLint bound = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &bound);
+    makeRoom(0);  // the budget may have been lowered
+    for (const std::shared_ptr<Texture>& t : textures_) {
+        if (t->state != State::Decoding || !t->decoded) continue;
+        adopt(*t);
+        if (t->state == State::Failed) continue;
+        std::cout << "TEXTURE::CACHE: " << (t->cacheHit ? "hit " : "miss ") << t->cacheFile << " (" << t->path << "), "
+                  << t->levels[0].width << "x" << t->levels[0].height << ", " << t->levels.size() << " levels, "
+                  << gpuBytes(t->tex) / 1024 << " KB" << (t->compressed ? " BC5" : "") << " (" << t->rawBytes / 1024
+                  << " KB raw), loaded in " << t->loadMs << " ms" << std::endl;
+    }
+    upload();
+    glBindTexture(GL_TEXTURE_2D, bound);
+    lastStallMs_ = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+    longestStallMs_ = std::max(longestStallMs_, lastStallMs_);
+    ++frame_;
+}
+
+void TextureLoader::request(GLuint tex, float screenPixels) {
+    Texture* t = find(tex);
+    if (!t) return;
+    // several draws of one texture in a frame: the largest footprint wins
+    t->footprint = t->lastUsed == frame_ ? std::max(t->footprint, screenPixels) : screenPixels;
+    t->lastUsed = frame_;
+}
+
+void TextureLoader::release(GLuint tex) {
+    auto it = std::find_if(textures_.begin(), textures_.end(), [tex](const std::shared_ptr<Texture>& t) { return t->tex == tex; });
+    if (it == textures_.end()) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.erase(std::remove(queue_.begin(), queue_.end(), *it), queue_.end());
+    }
+    // a worker still decoding it holds its own reference
+    if ((*it)->state != State::Failed) glDeleteTextures(1, &(*it)->tex);
+    residentBytes_ -= (*it)->allocatedBytes;
+    textures_.erase(it);
+}
+
+TextureLoader::Texture* TextureLoader::find(GLuint tex) const {
+    for (const std::shared_ptr<Texture>& t : textures_)
+        if (t->tex == tex) return t.get();
+    return nullptr;
+}
+
+// The worker fills levels, sizes and flags until `decoded`; state leaves Decoding only on the
+// render thread after that, so a texture past it is safe to read here.
+const TextureLoader::Texture* TextureLoader::findDecoded(GLuint tex) const {
+    const Texture* t = find(tex);
+    return t && t->state != State::Decoding ? t : nullptr;
+}
+
+bool TextureLoader::decoding(GLuint tex) const {
+    const Texture* t = find(tex);
+    return t && t->state == State::Decoding;
+}
+
+bool TextureLoader::ready(GLuint tex) const {
+    const Texture* t = find(tex);
+    return t && t->resident >= 0;
+}
+
+bool TextureLoader::failed(GLuint tex) const {
+    const Texture* t = find(tex);
+    return t && t->state == State::Failed;
+}
+
+int TextureLoader::baseLevel(GLuint tex) const {
+    const Texture* t = find(tex);
+    return t ? t->resident : -1;
+}
+
+int TextureLoader::wantedLevel(GLuint tex) const {
+    const Texture* t = find(tex);
+    return t && t->state == State::Streaming ? t->wanted() : -1;
+}
+
+bool TextureLoader::compressed(GLuint tex) const {
+    const Texture* t = findDecoded(tex);
+    return t && t->compressed;
+}
+
+bool TextureLoader::cacheHit(GLuint tex) const {
+    const Texture* t = findDecoded(tex);
+    return t && t->cacheHit;
+}
+
+double TextureLoader::loadMs(GLuint tex) const {
+    const Texture* t = findDecoded(tex);
+    return t ? t->loadMs : 0.0;
+}
+
+size_t TextureLoader::gpuBytes(GLuint tex) const {
+    const Texture* t = findDecoded(tex);
+    size_t bytes = 0;
+    if (t)
+        for (const Level& l : t->levels) bytes += l.rowBytes * l.rows;
+    return bytes;
+}
+
+size_t TextureLoader::rawBytes(GLuint tex) const {
+    const Texture* t = findDecoded(tex);
+    return t ? t->rawBytes : 0;
+}
+
+size_t TextureLoader::requestedBytes() const {
+    size_t bytes = 0;
+    for (const std::shared_ptr<Texture>& t : textures_) {
+        if (t->state != State::Streaming) continue;
+        for (int l = t->wanted(); l < (int)t->levels.size(); ++l) bytes += t->levels[l].rowBytes * t->levels[l].rows;
+    }
+    return bytes;
+}
+
+size_t TextureLoader::pending() const {
+    size_t n = 0;
+    for (const std::shared_ptr<Texture>& t : textures_)
+        n += t->state == State::Decoding || (t->state == State::Streaming && t->streamLevel() >= t->wanted());
+    return n;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MappedFile;
+
+// Loads 2D textures without stalling the frame loop. A worker pool decodes the image and
+// builds its mip chain; the render thread then uploads a bounded number of bytes per frame
+// through a ring of pixel buffers, each reused only once its fence has signaled. Levels go
+// up coarsest first across all pending textures and GL_TEXTURE_BASE_LEVEL follows the finest
+// complete level, so a texture shows blurry within a frame or two and sharpens as it streams.
+// Normal maps get renormalized mips and are BC5-compressed on the worker (texture_compress.h);
+// the shaders read only RG. The cooked chain is kept in the texture cache (texture_cache.h),
+// so a repeat load maps that file and streams its levels without decoding anything.
+//
+// Residency: each texture streams only down to the level its screen footprint needs
+// (request()), and finer levels follow when the footprint grows. Every level lives in its own
+// mutable storage so it can be freed alone. Starting a level that would exceed the budget
+// evicts, least recently used texture first, levels finer than a texture currently needs, or
+// any level above the mip tail of a texture not drawn this frame. The source stays mapped
+// (or in memory when it could not be cached) so evicted levels can stream back in.
+class TextureLoader {
+public:
+    static const size_t UPLOAD_BYTES_PER_FRAME = 4u << 20;  // also the size of each pixel buffer
+    static const int    STAGING_BUFFERS = 3;
+    static const size_t DEFAULT_BUDGET = 256u << 20;
+    static const int    TAIL_SIZE = 64;   // levels this size and smaller are never evicted
+
+    ~TextureLoader();
+    // Returns the texture name right away; it samples as incomplete until ready().
+    // `threads` sizes the decode pool on the first call (0 = hardware concurrency - 1).
+    GLuint load(const std::string& path, bool normalMap = false, unsigned threads = 0);
+
+    // Deletes the texture and forgets it; safe while it is still decoding.
+    void release(GLuint tex);
+
+    // Render thread, for each texture drawn this frame: `screenPixels` is the size in pixels
+    // its full [0,1] UV range covers on screen. Keeps the finest needed level streaming in and
+    // marks the texture used for LRU eviction.
+    void request(GLuint tex, float screenPixels);
+
+    // Render thread, once per frame: adopts decoded images, applies the budget and uploads
+    // the next slice. A texture counts as in use when request()ed since the previous poll().
+    void poll();
+
+    void   setBudget(size_t bytes) { budget_ = bytes; }
+    size_t budget() const { return budget_; }
+    size_t residentBytes() const { return residentBytes_; }   // allocated levels, all textures
+    size_t requestedBytes() const;                            // levels the current footprints need
+    size_t evictions() const { return evictions_; }           // levels freed under pressure
+
+    bool   ready(GLuint tex) const;       // at least one mip level resident
+    bool   failed(GLuint tex) const;      // decode failed; the name has been deleted
+    int    baseLevel(GLuint tex) const;   // finest resident level, -1 if none
+    int    wantedLevel(GLuint tex) const; // finest level the last request() needs
+    bool   decoding(GLuint tex) const;    // still on a worker; the getters below report nothing yet
+    bool   compressed(GLuint tex) const;
+    bool   cacheHit(GLuint tex) const;
+    double loadMs(GLuint tex) const;      // worker time: cache lookup, or decode + mips + compression
+    size_t gpuBytes(GLuint tex) const;    // full mip chain as uploaded
+    size_t rawBytes(GLuint tex) const;    // full mip chain as decoded
+    size_t pending() const;               // textures still decoding or short of their wanted level
+    size_t blocked() const { return blocked_; }  // of those, waiting on a budget nothing can be evicted for
+    size_t uploadedBytes() const { return uploadedBytes_; }
+    double lastStallMs() const { return lastStallMs_; }       // upload step of the last poll() with work
+    double longestStallMs() const { return longestStallMs_; }
+
+private:
+    enum class State { Decoding, Streaming, Failed };
+    // a row is one texel row, or one row of 4x4 blocks when compressed
+    struct Level { int width, height; size_t offset, rowBytes; int rows; };
+    struct Texture {
+        GLuint tex = 0;
+        std::string path;
+        State state = State::Decoding;
+        std::atomic<bool> decoded{ false };  // set by the worker once `levels` and `pixels` are filled
+        bool normalMap = false, compressed = false, cacheHit = false;
+        GLenum internalFormat = 0, format = 0;
+        size_t rawBytes = 0;
+        double loadMs = 0.0;
+        std::string cacheFile;
+        std::vector<Level> levels;
+        std::vector<unsigned char> pixels;   // every level, finest first, when cooked here
+        std::unique_ptr<MappedFile> file;    // or the cache file's mapping
+        const unsigned char* data = nullptr; // level bytes in either; kept to re-stream evicted levels
+        int resident = -1;                   // finest complete level, -1 if none
+        int nextRow = 0;                     // rows of level resident-1 (or the last) already sent
+        int tail = 0;                        // first level of the never-evicted mip tail
+        float footprint = 0.0f;              // last requested screen size, 0 = never drawn
+        unsigned lastUsed = 0;               // frame of the last request(), 0 = never
+        unsigned plannedFrame = ~0u;         // frame a copy was planned for it (not evictable then)
+        size_t allocatedBytes = 0;
+        int streamLevel() const { return (resident < 0 ? (int)levels.size() : resident) - 1; }
+        int wanted() const;
+    };
+    struct Staging { GLuint buffer = 0; GLsync fence = nullptr; };
+
+    void startWorkers(unsigned threads);
+    void workerLoop();
+    static void decode(Texture& t);
+    static bool cook(Texture& t, const unsigned char* source, size_t sourceBytes);
+    static bool loadCooked(Texture& t, std::uint64_t sourceHash, std::uint64_t settingsHash);
+    static bool saveCooked(const Texture& t, std::uint64_t sourceHash, std::uint64_t settingsHash);
+    void adopt(Texture& t);
+    void upload();
+    bool makeRoom(size_t bytes);
+    void evictOne(Texture& t);
+    void freeLevel(Texture& t, int level);
+    Texture* find(GLuint tex) const;
+    const Texture* findDecoded(GLuint tex) const;  // null while the worker still writes its fields
+
+    std::vector<std::shared_ptr<Texture>> textures_;
+    std::deque<std::shared_ptr<Texture>> queue_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+    Staging staging_[STAGING_BUFFERS];
+    int nextStaging_ = 0;
+    size_t uploadedBytes_ = 0;
+    size_t budget_ = DEFAULT_BUDGET, residentBytes_ = 0, evictions_ = 0, blocked_ = 0;
+    unsigned frame_ = 1;
+    double lastStallMs_ = 0.0, longestStallMs_ = 0.0;
+};
+
+#endif